@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ProbaUtils.h"
+#include "ColorTransfer.h"
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <tuple>
+#include <vector>
+
+
+class Checkpoint //Match solution and color transfer models of a mosaic, mosaics are rendered again without matching and fitting
+{
+private:
+    static constexpr unsigned int FileMagic = 0x4B43504D; //"MPCK"
+    static constexpr unsigned int FileVersion = 2;
+
+public:
+    struct TileReference
+    {
+        std::string _imagePath;
+        cv::Rect _box;
+        ProbaUtils::GMMNDComponents<3> _gmm;
+    };
+
+    struct Cell
+    {
+        int _tile; //Index in tile references
+        ColorTransfer::Model _model;
+    };
+
+public:
+    Checkpoint(const std::string& photoPath, std::tuple<int, int> grid, double scale, std::tuple<int, int, bool> resolution, ColorTransfer::Engine colorEngine, bool preview, int tileReduction);
+    Checkpoint(const std::string& path);
+    ~Checkpoint();
+
+public:
+    void save(const std::string& path) const;
+    const std::string& getPhotoPath() const;
+    std::tuple<int, int> getGrid() const;
+    double getScale() const;
+    std::tuple<int, int, bool> getResolution() const;
+    ColorTransfer::Engine getColorEngine() const;
+    bool getPreview() const;
+    int getTileReduction() const;
+    std::vector<TileReference>& getTiles();
+    std::vector<Cell>& getCells();
+
+private:
+    std::string _photoPath;
+    std::tuple<int, int> _grid;
+    double _scale;
+    std::tuple<int, int, bool> _resolution;
+    ColorTransfer::Engine _colorEngine;
+    bool _preview;
+    int _tileReduction; //Decode reduction of tile images, crop boxes refer to reduced images
+    std::vector<TileReference> _tiles;
+    std::vector<Cell> _cells;
+};
@@ -1,42 +1,83 @@
 #pragma once
 
 #include "Photo.h"
+#include "ColorTransfer.h"
 #include "MathUtils.h"
 #include "ProbaUtils.h"
 #include "GaussianMixtureModel.h"
+#include "ImageUtils.h"
 #include <tuple>
 #include <unordered_map>
 
 
-class ColorEnhancer
+class ColorEnhancer : public ColorTransfer //Gaussian mixtures optimal transport, filtered with a guided filter
 {
+    friend class ColorEnhancerTests; //Lattice transfer and sampling coverage are checked and measured by the test project
+
 private:
     static constexpr int FilterRadius = 4;
     static constexpr double FilterEpsilon = (0.01 * 255) * (0.01 * 255);
+    static constexpr int FilterSubsampling2MinSize = 128; //Minimum tile side for 2x subsampled guided filter
+    static constexpr int FilterSubsampling4MinSize = 256; //Minimum tile side for 4x subsampled guided filter
     static constexpr double GSSTolerance = 1e-3;
     static constexpr int CoverageGridDivisions = 32;
     static constexpr double CoverageConfidence = 0.95;
     static constexpr double CoverageMinRatio = 0.1;
+    static constexpr int LutSize = 17; //Color transfer lattice nodes per channel
+    static constexpr double LutExactMinShare = 1e-2; //Tile colors covering this pixel share keep the exact transfer
+
+public:
+    class Source : public ColorTransfer::Source
+    {
+        friend class ColorEnhancer;
+        friend class ColorEnhancerTests;
+
+    public:
+        Source(const ProbaUtils::Histogram<3>& histogram, const ProbaUtils::GMMNDComponents<3>& gmm, const ProbaUtils::GMMSamplerDatas<3>& datas, const cv::Size& size);
+        ~Source();
+
+    private:
+        const ProbaUtils::Histogram<3>& _histogram;
+        const ProbaUtils::GMMNDComponents<3>& _gmm;
+        std::vector<double> _histCompProbas; //Exact engine only
+        std::vector<double> _lutCompProbas; //Lattice engine only
+        std::vector<int> _lutExactIds; //Lattice engine only, dominant and saturated tile colors
+        std::vector<MathUtils::VectorNd<3>> _lutExactValues;
+        std::vector<double> _lutExactCompProbas;
+        bool _useLut;
+        double _coverage;
+        ImageUtils::GuidedFilter _guidedFilter; //Guide terms shared by every cell using the tile
+    };
+
+public:
+    static CostProfile getCostProfile();
 
 public:
-    ColorEnhancer(const ProbaUtils::Histogram<3>& sourceHistogram, const ProbaUtils::GMMNDComponents<3>& sourceGmm, const ProbaUtils::GMMNDComponents<3>& targetGmm, const ProbaUtils::GMMSamplerDatas<3>& datas);
+    ColorEnhancer(const Source& source, const ProbaUtils::GMMNDComponents<3>& targetGmm, const ProbaUtils::GMMSamplerDatas<3>& datas, const Model* model = nullptr);
     ~ColorEnhancer();
 
 public:
-    void apply(cv::Mat& enhancedImage, double blending);
+    void apply(cv::Mat& enhancedImage, double blending) override;
+    Model getModel() const override;
 
 private:
-    double computeGMMSamplingCoverage(const ProbaUtils::GMMNDComponents<3>& gmm, int nbDivisions, double confidence);
+    static std::vector<double> computeGuide(const ProbaUtils::Histogram<3>& histogram);
+    static int computeFilterSubsampling(const cv::Size& size);
+    static const std::vector<MathUtils::VectorNd<3>>& getLutLattice();
+    static double computeGMMSamplingCoverage(const ProbaUtils::GMMNDComponents<3>& gmm, const ProbaUtils::GMMSamplerDatas<3>& datas, int nbDivisions, double confidence);
     double computeCoverageDist(double t, double coverage);
     double goldenSectionSearch(double coverage);
     void computeColorMap(std::vector<MathUtils::VectorNd<3>>& colorMap, double t) const;
+    void computeTransfer(std::vector<MathUtils::VectorNd<3>>& colorMap, const std::vector<MathUtils::VectorNd<3>>& values, const std::vector<double>& compProbas, double t) const;
+    void interpolateLut(std::vector<MathUtils::VectorNd<3>>& colorMap, const std::vector<MathUtils::VectorNd<3>>& lut) const;
 
 private:
+    const Source& _source;
     const ProbaUtils::Histogram<3>& _sourceHistogram;
     const ProbaUtils::GMMNDComponents<3>& _sourceGmm;
     const ProbaUtils::GMMNDComponents<3>& _targetGmm;
     const ProbaUtils::GMMSamplerDatas<3>& _datas;
-    std::vector<double> _histCompProbas;
-    ProbaUtils::W2Minimizers _wstar;
+    ProbaUtils::GMMTransport<3> _transport;
     double _blendingScale;
+    ImageUtils::GuidedFilter::Buffers _filterBuffers;
 };
\ No newline at end of file
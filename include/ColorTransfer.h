@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ProbaUtils.h"
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+
+
+class ColorTransfer //Color transfer from a tile toward a photo cell, engines trade fidelity for speed
+{
+public:
+    enum Engine
+    {
+        GMM_OT,
+        REINHARD,
+        HISTOGRAM
+    };
+
+    struct CostProfile
+    {
+        std::string _name;
+        bool _colorModels; //Tile and cell gaussian mixtures must be fitted
+        std::string _tileCost;
+        std::string _cellCost;
+    };
+
+    class Source //Tile data, computed once and shared read-only by every cell using the tile
+    {
+    public:
+        virtual ~Source() {};
+    };
+
+    struct Model //Cell data computed by engines from color models, stored in checkpoints to skip fitting on later renders
+    {
+        ProbaUtils::GMMTransport<3> _transport;
+        double _blendingScale = 1.;
+    };
+
+public:
+    static bool findEngine(const std::string& name, Engine& engine);
+    static CostProfile getCostProfile(Engine engine);
+    static std::shared_ptr<const Source> createSource(Engine engine, const ProbaUtils::Histogram<3>& histogram, const ProbaUtils::GMMNDComponents<3>& gmm, const ProbaUtils::GMMSamplerDatas<3>& datas, const cv::Size& size);
+    static std::unique_ptr<ColorTransfer> create(Engine engine, const Source& source, const cv::Mat& cell, const ProbaUtils::GMMNDComponents<3>& cellGmm, const ProbaUtils::GMMSamplerDatas<3>& datas, const Model* model = nullptr);
+
+public:
+    virtual ~ColorTransfer() {};
+    virtual void apply(cv::Mat& enhancedImage, double blending) = 0;
+    virtual Model getModel() const { return Model(); }
+
+private:
+    static constexpr Engine Engines[3] = {GMM_OT, REINHARD, HISTOGRAM};
+};
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <atomic>
 
 
 namespace Console
@@ -29,6 +30,7 @@ namespace Console
         static void addBarSteps(int steps);
         static void startBar(Type type);
         static void waitBar();
+        static void setSilent(bool silent);
 
     private:
         Out();
@@ -44,6 +46,7 @@ namespace Console
         std::mutex _mutex;
         ProgressBar _progressBar;
         std::thread* _thread;
+        std::atomic<bool> _silent; //Server mode keeps standard output for its protocol
     };
 
     class Message
@@ -73,17 +76,19 @@ inline Console::Message Console::Out::get(Type type)
 
 inline void Console::Out::initBar(const std::string& text, int nbSteps)
 {
-    get()._progressBar.initialize(text, 70, nbSteps);
+    if (!get()._silent)
+        get()._progressBar.initialize(text, 70, nbSteps);
 }
 
 inline void Console::Out::addBarSteps(int steps)
 {
-    get()._progressBar.addSteps(steps);
+    if (!get()._silent)
+        get()._progressBar.addSteps(steps);
 }
 
 inline void Console::Out::startBar(Type type)
 {
-    if (!get()._thread)
+    if (!get()._thread && !get()._silent)
     {
         get()._thread = new std::thread(&ProgressBar::threadUpdate, &get()._progressBar);
     }
@@ -99,8 +104,13 @@ inline void Console::Out::waitBar()
     }
 }
 
+inline void Console::Out::setSilent(bool silent)
+{
+    get()._silent = silent;
+}
+
 inline Console::Out::Out() :
-    _progressBar(std::cout), _thread(nullptr)
+    _progressBar(std::cout), _thread(nullptr), _silent(false)
 {
 }
 
@@ -116,7 +126,7 @@ inline Console::Message Console::Out::createMessage(Type type)
 
 inline void Console::Out::output(Type type, const std::string& message)
 {
-    if (!_thread)
+    if (!_thread && !_silent)
     {
         std::lock_guard<std::mutex> lock(_mutex);
         SetColor(type);
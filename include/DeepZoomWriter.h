@@ -0,0 +1,48 @@
+#pragma once
+
+#include "MosaicWriter.h"
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+
+class DeepZoomWriter : public MosaicWriter //Deep Zoom pyramid, each level keeps one strip of tiles and lower levels are fed with 2x downsampled rows
+{
+private:
+    static constexpr int TileSize = 256;
+    static constexpr int TileOverlap = 0;
+
+public:
+    DeepZoomWriter(const std::string& path, const cv::Size& size, int quality);
+    ~DeepZoomWriter();
+
+public:
+    void write(const cv::Mat& band) override;
+    void finish() override;
+
+private:
+    struct Level
+    {
+        cv::Size _size;
+        cv::Mat _strip;
+        int _nbStripRows = 0;
+        int _nbStrips = 0;
+        int _nbRows = 0;
+        std::vector<unsigned char> _pendingRow; //Odd row waiting for its pair before downsampling
+        std::vector<unsigned char> _downsampledRow;
+    };
+
+private:
+    void addRow(int level, const unsigned char* row);
+    void downsampleRows(int level, const unsigned char* row0, const unsigned char* row1);
+    void flushStrip(int level);
+    void writeDescriptor() const;
+
+private:
+    const std::string _path;
+    const std::string _tilesPath;
+    const cv::Size _size;
+    const int _quality;
+    std::vector<Level> _levels; //Level 0 is 1*1, last level has full resolution
+    bool _finished;
+};
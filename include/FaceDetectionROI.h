@@ -13,6 +13,14 @@ private:
     static constexpr double LowFaceConfidence = 0.5;
     static constexpr double FaceBoxTolerance = 0.15;
 
+public:
+    struct Detection //Faces of an image, detected once for all the crops of the image
+    {
+        bool _done = false;
+        cv::Mat _faces;
+        double _scaleInv = 1.;
+    };
+
 public:
     FaceDetectionROI();
     ~FaceDetectionROI();
@@ -20,8 +28,10 @@ public:
 public:
     void initialize();
     void find(const cv::Mat& image, cv::Rect& box, bool rowDirSearch, int threadID) const;
+    void find(const cv::Mat& image, cv::Rect& box, bool rowDirSearch, int threadID, Detection& detection) const;
 
 private:
+    void detect(const cv::Mat& image, Detection& detection, int threadID) const;
     void getDetectionROI(const cv::Size& imageSize, const cv::Mat& faces, cv::Rect& box, double scaleInv, bool rowDirSearch) const;
     void getDefaultROI(const cv::Size& imageSize, cv::Rect& box, bool rowDirSearch) const;
 
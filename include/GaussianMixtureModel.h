@@ -7,17 +7,20 @@
 #include <map>
 #include <set>
 #include <numbers>
+#include <algorithm>
 
 
 template<unsigned int N>
 class GaussianMixtureModel
 {
 public:
-    static bool findOptimalComponents(ProbaUtils::GMMNDComponents<N>& optimalComponents, const ProbaUtils::Histogram<N>& histogram, int minNbComponents, int maxNbComponents, int nbInit, int nbIter, double convergenceTol, double covarianceReg, bool defaultSeed);
+    static bool findOptimalComponents(ProbaUtils::GMMNDComponents<N>& optimalComponents, const ProbaUtils::Histogram<N>& histogram, int minNbComponents, int maxNbComponents, int nbInit, int nbIter, double convergenceTol, double covarianceReg, bool defaultSeed, ProbaUtils::GMMFitStats& stats, int BICPatience = 0);
 
 public:
-    GaussianMixtureModel(const ProbaUtils::Histogram<N>& histogram, int nbInit, int nbIter, double convergenceTol, double covarianceReg, bool defaultSeed);
-    bool run(int nbComponents);
+    GaussianMixtureModel(const ProbaUtils::Histogram<N>& histogram, int nbInit, int nbIter, double convergenceTol, double covarianceReg, bool defaultSeed, bool accelerated = true);
+    bool run(int nbComponents, ProbaUtils::GMMFitStats& stats);
+    bool refine(const ProbaUtils::GMMNDComponents<N>& components, int nbIter, ProbaUtils::GMMFitStats& stats);
+    bool split(ProbaUtils::GMMFitStats& stats);
     double getBIC();
     ProbaUtils::GMMNDComponents<N> getComponents();
 
@@ -31,8 +34,15 @@ private:
 private:
     bool checkValidity(int nbComponents);
     void regularizeCovariance(double* covarianceData);
-    void runKmeansPlusPlus(int nbComponents);
-    double runExpectationMaximization(int nbComponents);
+    void runKmeansPlusPlus(int nbComponents, ProbaUtils::GMMFitStats& stats);
+    static double sqDistance(const MathUtils::VectorNd<N>& a, const MathUtils::VectorNd<N>& b);
+    void assignClosestCluster(int valueId, const ProbaUtils::GMMNDComponents<N>& components, std::vector<int>& assignedCluster, std::vector<double>& upperBounds, std::vector<double>& lowerBounds) const;
+    double runExpectationMaximization(int nbComponents, int nbIter, ProbaUtils::GMMFitStats& stats);
+    double runEMStep(std::vector<double>& probas, std::vector<double>& norms, int nbComponents);
+    double evaluate(std::vector<double>& probas, std::vector<double>& norms, int nbComponents) const;
+    bool hasConverged(double logLH, double newLogLH) const;
+    bool extrapolate(const std::vector<double>& params0, const std::vector<double>& params1, const std::vector<double>& params2, int nbComponents);
+    static void toParameters(std::vector<double>& params, const ProbaUtils::GMMNDComponents<N>& components);
     double logLikelihood(const std::vector<double>& norms, int nbComponents) const;
     void computeBIC(double logLH, int nbComponents);
 
@@ -42,30 +52,41 @@ private:
     const double _convergenceTol;
     const double _covarianceReg;
     const bool _defaultSeed;
+    const bool _accelerated;
     const ProbaUtils::Histogram<N>& _histogram;
+    ProbaUtils::HistogramSoA<N, double> _histogramSoA;
     ProbaUtils::GMMNDComponents<N> _components;
     double _BIC;
 };
 
 
 template<unsigned int N>
-bool GaussianMixtureModel<N>::findOptimalComponents(ProbaUtils::GMMNDComponents<N>& optimalComponents, const ProbaUtils::Histogram<N>& histogram, int minNbComponents, int maxNbComponents, int nbInit, int nbIter, double convergenceTol, double covarianceReg, bool defaultSeed)
+bool GaussianMixtureModel<N>::findOptimalComponents(ProbaUtils::GMMNDComponents<N>& optimalComponents, const ProbaUtils::Histogram<N>& histogram, int minNbComponents, int maxNbComponents, int nbInit, int nbIter, double convergenceTol, double covarianceReg, bool defaultSeed, ProbaUtils::GMMFitStats& stats, int BICPatience)
 {
-    GaussianMixtureModel<N> gmm(histogram, nbInit, nbIter, convergenceTol, covarianceReg, defaultSeed);
     double optimalBIC = MathUtils::DoubleMax;
     bool found = false;
 
+    //Each component number is warm started from previous solution, search stops when BIC keeps rising
+    GaussianMixtureModel<N> gmm(histogram, nbInit, nbIter, convergenceTol, covarianceReg, defaultSeed);
+    int nbBICRises = 0;
+
     for (int nbComponents = minNbComponents; nbComponents <= maxNbComponents; nbComponents++)
     {
-        found = gmm.run(nbComponents);
-        if (found)
+        const bool valid = (nbComponents == minNbComponents) ? gmm.run(nbComponents, stats) : gmm.split(stats);
+        if (!valid)
+            break;
+
+        double BIC = gmm.getBIC();
+        if (BIC < optimalBIC)
         {
-            double BIC = gmm.getBIC();
-            if (BIC < optimalBIC)
-            {
-                optimalComponents = gmm.getComponents();
-                optimalBIC = BIC;
-            }
+            optimalComponents = gmm.getComponents();
+            optimalBIC = BIC;
+            nbBICRises = 0;
+            found = true;
+        }
+        else if (BICPatience > 0 && ++nbBICRises >= BICPatience)
+        {
+            break;
         }
     }
 
@@ -73,21 +94,73 @@ bool GaussianMixtureModel<N>::findOptimalComponents(ProbaUtils::GMMNDComponents<
 }
 
 template<unsigned int N>
-GaussianMixtureModel<N>::GaussianMixtureModel(const ProbaUtils::Histogram<N>& histogram, int nbInit, int nbIter, double convergenceTol, double covarianceReg, bool defaultSeed) :
-    _histogram(histogram), _nbInit(nbInit), _nbIter(nbIter), _convergenceTol(convergenceTol), _defaultSeed(defaultSeed), _covarianceReg(covarianceReg), _BIC(MathUtils::DoubleMax)
+GaussianMixtureModel<N>::GaussianMixtureModel(const ProbaUtils::Histogram<N>& histogram, int nbInit, int nbIter, double convergenceTol, double covarianceReg, bool defaultSeed, bool accelerated) :
+    _histogram(histogram), _nbInit(nbInit), _nbIter(nbIter), _convergenceTol(convergenceTol), _defaultSeed(defaultSeed), _accelerated(accelerated), _covarianceReg(covarianceReg), _BIC(MathUtils::DoubleMax)
 {
+    ProbaUtils::toSoA(_histogramSoA, _histogram);
 }
 
 template<unsigned int N>
-bool GaussianMixtureModel<N>::run(int nbComponents)
+bool GaussianMixtureModel<N>::run(int nbComponents, ProbaUtils::GMMFitStats& stats)
 {
     if (!checkValidity(nbComponents))
         return false;
 
     _components.resize(nbComponents);
 
-    runKmeansPlusPlus(nbComponents);
-    double logLH = runExpectationMaximization(nbComponents);
+    runKmeansPlusPlus(nbComponents, stats);
+    double logLH = runExpectationMaximization(nbComponents, _nbIter, stats);
+    computeBIC(logLH, nbComponents);
+
+    return true;
+}
+
+template<unsigned int N>
+bool GaussianMixtureModel<N>::refine(const ProbaUtils::GMMNDComponents<N>& components, int nbIter, ProbaUtils::GMMFitStats& stats)
+{
+    const int nbComponents = components.size();
+    if (!checkValidity(nbComponents))
+        return false;
+
+    _components = components;
+
+    double logLH = runExpectationMaximization(nbComponents, nbIter, stats);
+    computeBIC(logLH, nbComponents);
+
+    return true;
+}
+
+template<unsigned int N>
+bool GaussianMixtureModel<N>::split(ProbaUtils::GMMFitStats& stats)
+{
+    const int nbComponents = _components.size() + 1;
+    if (_components.empty() || !checkValidity(nbComponents))
+        return false;
+
+    //Split component with highest weighted principal variance along its principal axis
+    int splitId = 0;
+    double maxVariance = -1;
+    MathUtils::VectorNd<N> splitAxis;
+    for (int c = 0; c < _components.size(); c++)
+    {
+        Eigen::SelfAdjointEigenSolver<MathUtils::MatrixNd<N>> eigen(_components[c]._covariance);
+        const double variance = _components[c]._weight * eigen.eigenvalues()(N - 1);
+        if (variance > maxVariance)
+        {
+            maxVariance = variance;
+            splitId = c;
+            splitAxis = eigen.eigenvectors().col(N - 1) * std::sqrt(std::max(eigen.eigenvalues()(N - 1), 0.));
+        }
+    }
+
+    ProbaUtils::GaussianComponent<N> splitComponent = _components[splitId];
+    splitComponent._weight *= 0.5;
+    _components[splitId] = splitComponent;
+    _components[splitId]._mean -= splitAxis;
+    splitComponent._mean += splitAxis;
+    _components.emplace_back(splitComponent);
+
+    double logLH = runExpectationMaximization(nbComponents, _nbIter, stats);
     computeBIC(logLH, nbComponents);
 
     return true;
@@ -119,7 +192,7 @@ inline void GaussianMixtureModel<N>::regularizeCovariance(double* covarianceData
 }
 
 template<unsigned int N>
-void GaussianMixtureModel<N>::runKmeansPlusPlus(int nbComponents)
+void GaussianMixtureModel<N>::runKmeansPlusPlus(int nbComponents, ProbaUtils::GMMFitStats& stats)
 {
     const int nbValues = _histogram._values.size();
 
@@ -130,97 +203,143 @@ void GaussianMixtureModel<N>::runKmeansPlusPlus(int nbComponents)
     double bestInertia = MathUtils::DoubleMax;
     std::vector<ClusterData> bestClusters(nbComponents);
     std::vector<int> bestAssignedCluster(nbValues, -1);
-    std::vector<int> intervals(2 * nbValues);
-    std::vector<double> weights(intervals.size() - 1, 0);
-    MathUtils::VectorNd<N> meanValDiff;
+    std::vector<double> sqDistances(nbValues);
+    std::vector<double> cumulatedWeights(nbValues);
+    long long nbDistances = 0;
+    long long nbSkipped = 0;
+
+    //Hamerly bounds : distance to assigned centroid (upper) and to second closest centroid (lower)
+    std::vector<double> upperBounds(nbValues);
+    std::vector<double> lowerBounds(nbValues);
+    std::vector<double> halfCentroidDistances(nbComponents);
+    std::vector<double> centroidMoves(nbComponents);
 
     for (int i = 0; i < _nbInit; i++)
     {
         ProbaUtils::GMMNDComponents<N> components(nbComponents);
 
-        //Choose initial clusters (means)
+        //Choose initial clusters (means), sampling is done by binary search on cumulated weights
         components[0]._mean = _histogram._values[uniform(*gen.get())];
-
-        std::fill(weights.begin(), weights.end(), 0);
-        for (int b = 0; b < nbValues; b++)
-        {
-            intervals[2 * b] = b;
-            intervals[2 * b + 1] = b + 1;
-            weights[2 * b] = MathUtils::IntMax;
-        }
+        std::fill(sqDistances.begin(), sqDistances.end(), MathUtils::DoubleMax);
 
         for (int c = 1; c < nbComponents; c++)
         {
+            double cumulatedWeight = 0;
             for (int b = 0; b < nbValues; b++)
             {
-                MathUtils::VectorNd<N> meanValDiff = components[c - 1]._mean - _histogram._values[b];
-                int sqDistance = 0;
-                for (int i = 0; i < N; i++)
-                    sqDistance += meanValDiff.data()[i] * meanValDiff.data()[i];
-                if (sqDistance < weights[2 * b])
-                    weights[2 * b] = sqDistance;
+                sqDistances[b] = std::min(sqDistances[b], sqDistance(components[c - 1]._mean, _histogram._values[b]));
+                cumulatedWeight += sqDistances[b];
+                cumulatedWeights[b] = cumulatedWeight;
             }
 
-            std::piecewise_constant_distribution<> pieceConstDistr(intervals.begin(), intervals.end(), weights.begin());
-            components[c]._mean = _histogram._values[pieceConstDistr(*gen.get())];
+            int seedId = uniform(*gen.get());
+            if (cumulatedWeight > 0)
+            {
+                std::uniform_real_distribution<double> uniformWeight(0, cumulatedWeight);
+                seedId = std::upper_bound(cumulatedWeights.begin(), cumulatedWeights.end(), uniformWeight(*gen.get())) - cumulatedWeights.begin();
+                seedId = std::min(seedId, nbValues - 1);
+            }
+            components[c]._mean = _histogram._values[seedId];
         }
+        nbDistances += (long long)(nbComponents - 1) * nbValues;
 
-        //Iteration step
+        //Initial assignment, each point is assigned to closest cluster centroid
         std::vector<ClusterData> clusters(nbComponents);
         std::vector<int> assignedCluster(nbValues, -1);
-        double inertia = MathUtils::DoubleMax;
-        double sqDistanceMax = MathUtils::DoubleMax;
-        int iteration = 0;
+        for (ClusterData& cluster : clusters)
+        {
+            cluster._sum.setZero();
+            cluster._count = 0;
+        }
 
-        while (sqDistanceMax > _convergenceTol && iteration < _nbIter)
+        for (int b = 0; b < nbValues; b++)
         {
-            for (ClusterData& cluster : clusters)
-            {
-                cluster._sum.setZero();
-                cluster._count = 0;
-            }
+            assignClosestCluster(b, components, assignedCluster, upperBounds, lowerBounds);
+            clusters[assignedCluster[b]]._sum += _histogram._values[b] * (double)_histogram._counts[b];
+            clusters[assignedCluster[b]]._count += _histogram._counts[b];
+        }
+        nbDistances += (long long)nbComponents * nbValues;
 
-            //Assign each point to closest cluster centroid
-            inertia = 0;
-            for (int b = 0; b < nbValues; b++)
+        //Iteration step
+        int iteration = 0;
+        while (true)
+        {
+            //Compute new centroids, empty clusters keep their centroid
+            double sqDistanceMax = 0;
+            int maxMoveId = 0;
+            for (int c = 0; c < nbComponents; c++)
             {
-                double sqDistanceMin = MathUtils::DoubleMax;
-                for (int c = 0; c < nbComponents; c++)
+                centroidMoves[c] = 0;
+                if (clusters[c]._count > 0)
                 {
-                    meanValDiff = components[c]._mean - _histogram._values[b];
-                    int sqDistance = 0;
-                    for (int i = 0; i < N; i++)
-                        sqDistance += meanValDiff.data()[i] * meanValDiff.data()[i];
-                    if (sqDistance < sqDistanceMin)
-                    {
-                        assignedCluster[b] = c;
-                        sqDistanceMin = sqDistance;
-                    }
+                    MathUtils::VectorNd<N> newCentroid = clusters[c]._sum / (double)clusters[c]._count;
+                    double sqMove = sqDistance(components[c]._mean, newCentroid);
+                    centroidMoves[c] = std::sqrt(sqMove);
+                    sqDistanceMax = std::max(sqDistanceMax, sqMove);
+                    components[c]._mean = newCentroid;
                 }
-                clusters[assignedCluster[b]]._sum += _histogram._values[b] * (double)_histogram._counts[b];
-                clusters[assignedCluster[b]]._count += _histogram._counts[b];
-                inertia += sqDistanceMin;
+                if (centroidMoves[c] > centroidMoves[maxMoveId])
+                    maxMoveId = c;
             }
+            iteration++;
+
+            if (sqDistanceMax <= _convergenceTol || iteration >= _nbIter)
+                break;
+
+            double secondMaxMove = 0;
+            for (int c = 0; c < nbComponents; c++)
+                if (c != maxMoveId)
+                    secondMaxMove = std::max(secondMaxMove, centroidMoves[c]);
 
-            //Compute new centroids
-            sqDistanceMax = 0;
             for (int c = 0; c < nbComponents; c++)
             {
-                MathUtils::VectorNd<N> newCentroid = clusters[c]._sum / (double)clusters[c]._count;
-                meanValDiff = components[c]._mean - newCentroid;
-                int sdDistance = 0;
-                for (int i = 0; i < N; i++)
-                    sdDistance += meanValDiff.data()[i] * meanValDiff.data()[i];
+                double minDistance = MathUtils::DoubleMax;
+                for (int o = 0; o < nbComponents; o++)
+                    if (o != c)
+                        minDistance = std::min(minDistance, sqDistance(components[c]._mean, components[o]._mean));
+                halfCentroidDistances[c] = 0.5 * std::sqrt(minDistance);
+            }
 
-                if (sdDistance > sqDistanceMax)
-                    sqDistanceMax = sdDistance;
+            //Reassign points whose bounds can not guarantee current assignment
+            for (int b = 0; b < nbValues; b++)
+            {
+                const int cluster = assignedCluster[b];
+                upperBounds[b] += centroidMoves[cluster];
+                lowerBounds[b] -= (cluster == maxMoveId) ? secondMaxMove : centroidMoves[maxMoveId];
 
-                components[c]._mean = newCentroid;
-            }
+                const double bound = std::max(halfCentroidDistances[cluster], lowerBounds[b]);
+                if (upperBounds[b] <= bound)
+                {
+                    nbSkipped += nbComponents;
+                    continue;
+                }
 
-            iteration++;
+                upperBounds[b] = std::sqrt(sqDistance(components[cluster]._mean, _histogram._values[b]));
+                nbDistances++;
+                if (upperBounds[b] <= bound)
+                {
+                    nbSkipped += nbComponents - 1;
+                    continue;
+                }
+
+                assignClosestCluster(b, components, assignedCluster, upperBounds, lowerBounds);
+                nbDistances += nbComponents;
+                if (assignedCluster[b] != cluster)
+                {
+                    const MathUtils::VectorNd<N> weightedValue = _histogram._values[b] * (double)_histogram._counts[b];
+                    clusters[cluster]._sum -= weightedValue;
+                    clusters[cluster]._count -= _histogram._counts[b];
+                    clusters[assignedCluster[b]]._sum += weightedValue;
+                    clusters[assignedCluster[b]]._count += _histogram._counts[b];
+                }
+            }
         }
 
+        double inertia = 0;
+        for (int b = 0; b < nbValues; b++)
+            inertia += sqDistance(components[assignedCluster[b]]._mean, _histogram._values[b]);
+        nbDistances += nbValues;
+
         if (inertia < bestInertia)
         {
             bestInertia = inertia;
@@ -230,16 +349,22 @@ void GaussianMixtureModel<N>::runKmeansPlusPlus(int nbComponents)
         }
     }
 
+    stats._kmeansDistances += nbDistances;
+    stats._kmeansSkippedDistances += nbSkipped;
+
     //Initialize variances and weights
+    for (int c = 0; c < nbComponents; c++)
+        _components[c]._covariance.setZero();
     for (int b = 0; b < nbValues; b++)
     {
         const int cluster = bestAssignedCluster[b];
-        meanValDiff = _histogram._values[b] - _components[cluster]._mean;
+        MathUtils::VectorNd<N> meanValDiff = _histogram._values[b] - _components[cluster]._mean;
         _components[cluster]._covariance += meanValDiff * meanValDiff.transpose() * (double)_histogram._counts[b];
     }
     for (int c = 0; c < nbComponents; c++)
     {
-        _components[c]._covariance = _components[c]._covariance / (double)bestClusters[c]._count;
+        if (bestClusters[c]._count > 0)
+            _components[c]._covariance = _components[c]._covariance / (double)bestClusters[c]._count;
         regularizeCovariance(_components[c]._covariance.data());
 
         _components[c]._weight = 1. / (double)nbComponents;
@@ -247,79 +372,203 @@ void GaussianMixtureModel<N>::runKmeansPlusPlus(int nbComponents)
 }
 
 template<unsigned int N>
-double GaussianMixtureModel<N>::runExpectationMaximization(int nbComponents)
+inline double GaussianMixtureModel<N>::sqDistance(const MathUtils::VectorNd<N>& a, const MathUtils::VectorNd<N>& b)
+{
+    return (a - b).squaredNorm();
+}
+
+template<unsigned int N>
+inline void GaussianMixtureModel<N>::assignClosestCluster(int valueId, const ProbaUtils::GMMNDComponents<N>& components, std::vector<int>& assignedCluster, std::vector<double>& upperBounds, std::vector<double>& lowerBounds) const
+{
+    double sqDistanceMin = MathUtils::DoubleMax;
+    double sqDistanceSecond = MathUtils::DoubleMax;
+    for (int c = 0; c < components.size(); c++)
+    {
+        double sqDist = sqDistance(components[c]._mean, _histogram._values[valueId]);
+        if (sqDist < sqDistanceMin)
+        {
+            sqDistanceSecond = sqDistanceMin;
+            sqDistanceMin = sqDist;
+            assignedCluster[valueId] = c;
+        }
+        else if (sqDist < sqDistanceSecond)
+        {
+            sqDistanceSecond = sqDist;
+        }
+    }
+    upperBounds[valueId] = std::sqrt(sqDistanceMin);
+    lowerBounds[valueId] = (sqDistanceSecond < MathUtils::DoubleMax) ? std::sqrt(sqDistanceSecond) : MathUtils::DoubleMax;
+}
+
+template<unsigned int N>
+double GaussianMixtureModel<N>::runExpectationMaximization(int nbComponents, int nbIter, ProbaUtils::GMMFitStats& stats)
 {
     const int nbValues = _histogram._values.size();
 
-    std::vector<double> probas(nbComponents * nbValues); //Gaussian PDF probabilities
+    std::vector<double> probas(nbComponents * nbValues); //Gaussian PDF probabilities, component-major
     std::vector<double> norms(nbValues); //Gaussian PDF density norms
-    std::vector<double> resps(nbComponents * nbValues); //Responsabilities
-    std::vector<double> composResp(nbComponents);
+    double logLH = evaluate(probas, norms, nbComponents);
+    bool converged = false;
     int iteration = 0;
-    ProbaUtils::evalGaussianPDF(probas, norms, _histogram._values, _components, true);
-    double logLH = logLikelihood(norms, nbComponents);
-    double logLHDiff = MathUtils::DoubleMax; //Log-likelihood iteration difference
-    MathUtils::VectorNd<N> meanValDiff;
 
-    while (logLHDiff > _convergenceTol && iteration < _nbIter)
+    if (!_accelerated)
     {
-        //Expectation step
-        for (int b = 0, r = 0; b < nbValues; b++)
-            for (int c = 0; c < nbComponents; c++, r++)
-                resps[r] = probas[r] * (double)_histogram._counts[b];
-
-        //Maximization step
-        for (int c = 0; c < nbComponents; c++)
+        while (!converged && iteration < nbIter)
         {
-            _components[c]._mean.setZero();
-            _components[c]._covariance.setZero();
-            composResp[c] = 0;
+            double newLogLH = runEMStep(probas, norms, nbComponents);
+            converged = hasConverged(logLH, newLogLH);
+            logLH = newLogLH;
+            iteration++;
         }
+    }
+    else
+    {
+        //SQUAREM : two EM steps give the extrapolation direction, extrapolated point is stabilized by a third EM step
+        std::vector<double> params0, params1, params2;
+        std::vector<double> stepProbas(probas.size());
+        ProbaUtils::GMMNDComponents<N> stepComponents;
 
-        for (int b = 0, r = 0; b < nbValues; b++)
+        while (!converged && iteration < nbIter)
         {
-            for (int c = 0; c < nbComponents; c++, r++)
+            toParameters(params0, _components);
+            double logLH1 = runEMStep(probas, norms, nbComponents);
+            converged = hasConverged(logLH, logLH1);
+            logLH = logLH1;
+            iteration++;
+            if (converged || iteration >= nbIter)
+                break;
+
+            toParameters(params1, _components);
+            double logLH2 = runEMStep(probas, norms, nbComponents);
+            converged = hasConverged(logLH, logLH2);
+            logLH = logLH2;
+            iteration++;
+            if (converged || iteration >= nbIter)
+                break;
+
+            //Plain EM iterate is kept as fallback when extrapolation breaks validity or monotonicity
+            toParameters(params2, _components);
+            stepComponents = _components;
+            stepProbas.swap(probas);
+
+            if (extrapolate(params0, params1, params2, nbComponents))
             {
-                composResp[c] += resps[r];
-                _components[c]._mean += resps[r] * _histogram._values[b];
+                evaluate(probas, norms, nbComponents);
+                double logLH3 = runEMStep(probas, norms, nbComponents);
+                iteration++;
+                if (logLH3 >= logLH2)
+                {
+                    converged = hasConverged(logLH2, logLH3);
+                    logLH = logLH3;
+                    continue;
+                }
             }
-        }
 
-        for (int c = 0; c < nbComponents; c++)
-        {
-            _components[c]._mean /= composResp[c];
+            _components = stepComponents;
+            probas.swap(stepProbas);
         }
+    }
+
+    stats._EMFits++;
+    stats._EMIterations += iteration;
+    if (!converged && nbIter > 0)
+        stats._EMCappedFits++;
+
+    return logLH;
+}
+
+template<unsigned int N>
+double GaussianMixtureModel<N>::runEMStep(std::vector<double>& probas, std::vector<double>& norms, int nbComponents)
+{
+    //Maximization step on count weighted responsabilities
+    ProbaUtils::computeGaussianStatistics(_components, probas, _histogramSoA);
+
+    for (int c = 0; c < nbComponents; c++)
+    {
+        regularizeCovariance(_components[c]._covariance.data());
+        _components[c]._weight /= _histogram._nbData;
+    }
+
+    //Expectation step
+    return evaluate(probas, norms, nbComponents);
+}
+
+template<unsigned int N>
+double GaussianMixtureModel<N>::evaluate(std::vector<double>& probas, std::vector<double>& norms, int nbComponents) const
+{
+    ProbaUtils::evalGaussianPDF(probas, norms, _histogramSoA, _components, true);
+    return logLikelihood(norms, nbComponents);
+}
 
-        for (int b = 0, r = 0; b < nbValues; b++)
+template<unsigned int N>
+inline bool GaussianMixtureModel<N>::hasConverged(double logLH, double newLogLH) const
+{
+    //Log-likelihood difference is normalized by the number of samples
+    return (newLogLH - logLH) / (double)_histogram._nbData <= _convergenceTol;
+}
+
+template<unsigned int N>
+bool GaussianMixtureModel<N>::extrapolate(const std::vector<double>& params0, const std::vector<double>& params1, const std::vector<double>& params2, int nbComponents)
+{
+    const int nbParams = params0.size();
+
+    double rSqNorm = 0, vSqNorm = 0;
+    for (int p = 0; p < nbParams; p++)
+    {
+        double r = params1[p] - params0[p];
+        double v = params2[p] - 2. * params1[p] + params0[p];
+        rSqNorm += r * r;
+        vSqNorm += v * v;
+    }
+    if (vSqNorm <= MathUtils::DoubleEpsilon * rSqNorm)
+        return false;
+
+    //Steplength is bounded by -1, which gives back the plain EM iterate
+    const double alpha = std::min(-std::sqrt(rSqNorm / vSqNorm), -1.);
+    if (alpha == -1.)
+        return false;
+
+    double weightSum = 0;
+    for (int c = 0, p = 0; c < nbComponents; c++)
+    {
+        double* component[3] = {&_components[c]._weight, _components[c]._mean.data(), _components[c]._covariance.data()};
+        const int sizes[3] = {1, N, N * N};
+        for (int k = 0; k < 3; k++)
         {
-            for (int c = 0; c < nbComponents; c++, r++)
+            for (int i = 0; i < sizes[k]; i++, p++)
             {
-                meanValDiff = _histogram._values[b] - _components[c]._mean;
-                for (int i = 0; i < N; i++)
-                    for (int j = 0; j < N; j++)
-                        _components[c]._covariance(i, j) += resps[r] * meanValDiff.data()[i] * meanValDiff.data()[j];
+                double r = params1[p] - params0[p];
+                double v = params2[p] - 2. * params1[p] + params0[p];
+                component[k][i] = params0[p] - 2. * alpha * r + alpha * alpha * v;
             }
-
         }
 
-        for (int c = 0; c < nbComponents; c++)
-        {
-            _components[c]._covariance /= composResp[c];
-            regularizeCovariance(_components[c]._covariance.data());
+        if (_components[c]._weight <= 0)
+            return false;
+        weightSum += _components[c]._weight;
 
-            _components[c]._weight = composResp[c] / _histogram._nbData;
-        }
+        _components[c]._covariance = 0.5 * (_components[c]._covariance + _components[c]._covariance.transpose());
+        Eigen::LLT<MathUtils::MatrixNd<N>> llt(_components[c]._covariance);
+        if (llt.info() != Eigen::Success)
+            return false;
+    }
 
-        //Compute log-likelihood
-        ProbaUtils::evalGaussianPDF(probas, norms, _histogram._values, _components, true);
-        double newLogLH = logLikelihood(norms, nbComponents);
-        logLHDiff = newLogLH - logLH;
-        logLH = newLogLH;
+    for (int c = 0; c < nbComponents; c++)
+        _components[c]._weight /= weightSum;
 
-        iteration++;
-    }
+    return true;
+}
 
-    return logLH;
+template<unsigned int N>
+void GaussianMixtureModel<N>::toParameters(std::vector<double>& params, const ProbaUtils::GMMNDComponents<N>& components)
+{
+    params.clear();
+    for (const auto& component : components)
+    {
+        params.push_back(component._weight);
+        params.insert(params.end(), component._mean.data(), component._mean.data() + N);
+        params.insert(params.end(), component._covariance.data(), component._covariance.data() + N * N);
+    }
 }
 
 template<unsigned int N>
@@ -329,7 +578,7 @@ double GaussianMixtureModel<N>::logLikelihood(const std::vector<double>& norms,
 
     double logLH = 0;
     for (int b = 0, e = 0; b < nbValues; b++)
-        logLH += log(norms[b]) * (double)_histogram._counts[b];
+        logLH += log((double)norms[b]) * (double)_histogram._counts[b];
 
     return logLH;
 }
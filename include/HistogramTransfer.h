@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ColorTransfer.h"
+#include "ProbaUtils.h"
+#include <array>
+
+
+class HistogramTransfer : public ColorTransfer //Per channel histogram matching through cumulative distribution lookup tables
+{
+private:
+    static constexpr int NbLevels = 256;
+
+    using ChannelCDFs = std::array<std::array<double, NbLevels>, 3>;
+
+public:
+    class Source : public ColorTransfer::Source
+    {
+        friend class HistogramTransfer;
+
+    public:
+        Source(const ProbaUtils::Histogram<3>& histogram);
+        ~Source();
+
+    private:
+        const ProbaUtils::Histogram<3>& _histogram;
+        ChannelCDFs _cdfs;
+    };
+
+public:
+    static CostProfile getCostProfile();
+
+public:
+    HistogramTransfer(const Source& source, const cv::Mat& cell);
+    ~HistogramTransfer();
+
+public:
+    void apply(cv::Mat& enhancedImage, double blending) override;
+
+private:
+    static void normalizeCDFs(ChannelCDFs& cdfs);
+
+private:
+    const Source& _source;
+    std::array<std::array<double, NbLevels>, 3> _luts;
+};
@@ -2,6 +2,7 @@
 
 #include <opencv2/opencv.hpp>
 #include <bitset>
+#include <string>
 
 
 namespace ImageUtils
@@ -29,6 +30,60 @@ namespace ImageUtils
 
     void DHash(const cv::Mat& image, Hash& hash);
 
+    bool readJpegSize(const std::string& path, cv::Size& size); //Size of the image given by cv::imread, false if not a readable JPEG
+
     void guidedFiltering(std::vector<double>& filtered, const std::vector<double>& image, const std::vector<double>& guide, const cv::Size& size, int radius, double epsilon);
+
+    class GuidedFilter //Single precision guided filter, guide terms are computed once and image terms are streamed through row buffers
+    {
+    public:
+        struct Buffers //Streaming buffers of one caller, a filter is shared by callers with their own buffers
+        {
+            std::vector<float> _imageShift;
+            std::vector<double> _levelImage;
+            std::vector<float> _imgSums;
+            std::vector<float> _imgGuideSums;
+            std::vector<float> _alphaSums;
+            std::vector<float> _betaSums;
+            std::vector<float> _rowBuffer0;
+            std::vector<float> _rowBuffer1;
+            std::vector<float> _alphaRing;
+            std::vector<float> _betaRing;
+            std::vector<float> _alphaMean; //Subsampled mode only
+            std::vector<float> _betaMean; //Subsampled mode only
+        };
+
+    public:
+        GuidedFilter(const std::vector<double>& guide, const cv::Size& size, int radius, double epsilon, int subsampling = 1);
+        ~GuidedFilter();
+
+    public:
+        void apply(std::vector<double>& filtered, const std::vector<double>& image, Buffers& buffers) const;
+
+    private:
+        struct Level //Resolution where linear coefficients are computed
+        {
+            cv::Size _size;
+            int _radius;
+            std::vector<float> _guideMean;
+            std::vector<float> _guideVarEps; //Guide variance + epsilon
+            std::vector<float> _invColCounts;
+        };
+
+    private:
+        void initializeBuffers(Buffers& buffers) const;
+        void boxFilterRow(float* output, const float* colSums, float invRowCount) const;
+        void computeCoefficients(const double* image, double* filtered, Buffers& buffers) const;
+        void storeCoefficientsRow(int i, const float* alphaMean, const float* betaMean, double* filtered, Buffers& buffers) const;
+        void upsampleCoefficients(double* filtered, const Buffers& buffers) const;
+
+    private:
+        const cv::Size _size;
+        const int _subsampling;
+        Level _level;
+        double _guideShift[3]; //Guide and image are centered so that float sums keep their precision
+        std::vector<float> _guide;
+        std::vector<float> _levelGuide; //Subsampled mode only, full resolution guide is used otherwise
+    };
 };
 
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "MosaicWriter.h"
+#include <opencv2/opencv.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+class JpegWriter : public MosaicWriter //Baseline JPEG encoder fed with row bands, each MCU row is a restart interval so MCU rows of consecutive bands are encoded in parallel
+{
+private:
+    static constexpr int BlockSize = 8;
+    static constexpr int MCURowsPerThread = 2; //Pending MCU rows per thread before encoding, bounds buffered rows
+    static constexpr int NbCoefficients = BlockSize * BlockSize;
+    static constexpr int ZigZag[NbCoefficients] = {
+        0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+public:
+    JpegWriter(const std::string& path, const cv::Size& size, int quality);
+    ~JpegWriter();
+
+public:
+    void write(const cv::Mat& band) override;
+    void finish() override;
+
+private:
+    struct HuffmanTable
+    {
+        unsigned short _codes[256];
+        unsigned char _lengths[256];
+    };
+
+    struct BitWriter
+    {
+        std::vector<unsigned char> _bytes;
+        unsigned long long _buffer = 0; //Up to 7 pending bits and 27 new bits
+        int _nbBits = 0;
+
+        void put(unsigned int bits, int nbBits);
+        void flush();
+    };
+
+private:
+    static void buildHuffmanTable(HuffmanTable& table, const unsigned char* bits, const unsigned char* values);
+    static void computeQuantization(float* quantization, unsigned char* table, const unsigned char* reference, int quality);
+    void writeHeaders();
+    void encodePendingRows(int nbRows);
+    void encodeMCURows(const unsigned char* const* rows, int nbMCURows, int nbLastRows);
+    void encodeMCURow(BitWriter& writer, const unsigned char* const* rows, int nbRows) const;
+    void encodeBlock(BitWriter& writer, const float* block, const float* quantization, const HuffmanTable& dcTable, const HuffmanTable& acTable, int& dcPredictor) const;
+
+private:
+    std::ofstream _stream;
+    const std::string _path;
+    const std::string _temporaryPath;
+    const cv::Size _size;
+    const int _nbMCURows;
+    std::vector<unsigned char> _pendingRows;
+    int _nbPendingRows;
+    int _nbWrittenRows;
+    int _nbWrittenMCURows;
+    bool _finished;
+    unsigned char _lumaTable[NbCoefficients];
+    unsigned char _chromaTable[NbCoefficients];
+    float _lumaQuantization[NbCoefficients];
+    float _chromaQuantization[NbCoefficients];
+    HuffmanTable _lumaDC;
+    HuffmanTable _lumaAC;
+    HuffmanTable _chromaDC;
+    HuffmanTable _chromaAC;
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+
+
+namespace JsonUtils //Flat JSON objects of the server protocol, values are strings, numbers, booleans, null or arrays of them
+{
+    enum Type
+    {
+        STRING,
+        NUMBER,
+        BOOLEAN,
+        NUL,
+        ARRAY
+    };
+
+    struct Member
+    {
+        std::string _key;
+        std::string _value; //Unescaped string, literal text or comma separated array elements
+        Type _type;
+    };
+
+    inline void skipSpaces(const std::string& text, size_t& pos)
+    {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n'))
+            pos++;
+    }
+
+    inline void appendUtf8(std::string& value, unsigned int codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            value += (char)codePoint;
+        }
+        else if (codePoint < 0x800)
+        {
+            value += (char)(0xC0 | (codePoint >> 6));
+            value += (char)(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            value += (char)(0xE0 | (codePoint >> 12));
+            value += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+            value += (char)(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            value += (char)(0xF0 | (codePoint >> 18));
+            value += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+            value += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+            value += (char)(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    inline bool parseHex(const std::string& text, size_t& pos, unsigned int& codeUnit)
+    {
+        if (pos + 4 > text.size())
+            return false;
+        codeUnit = 0;
+        for (int d = 0; d < 4; d++, pos++)
+        {
+            const char c = text[pos];
+            codeUnit <<= 4;
+            if ('0' <= c && c <= '9') codeUnit |= c - '0';
+            else if ('a' <= c && c <= 'f') codeUnit |= c - 'a' + 10;
+            else if ('A' <= c && c <= 'F') codeUnit |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    inline bool parseString(const std::string& text, size_t& pos, std::string& value)
+    {
+        if (pos >= text.size() || text[pos] != '"')
+            return false;
+        value.clear();
+        for (pos++; pos < text.size(); pos++)
+        {
+            const char c = text[pos];
+            if (c == '"')
+            {
+                pos++;
+                return true;
+            }
+            if (c != '\\')
+            {
+                value += c;
+                continue;
+            }
+            if (++pos >= text.size())
+                return false;
+            switch (text[pos])
+            {
+            case '"': value += '"'; break;
+            case '\\': value += '\\'; break;
+            case '/': value += '/'; break;
+            case 'b': value += '\b'; break;
+            case 'f': value += '\f'; break;
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case 'u':
+            {
+                unsigned int codePoint = 0, lowSurrogate = 0;
+                pos++;
+                if (!parseHex(text, pos, codePoint))
+                    return false;
+                //Surrogate pairs encode code points above the basic plane
+                if (0xD800 <= codePoint && codePoint < 0xDC00)
+                {
+                    if (text.compare(pos, 2, "\\u") != 0)
+                        return false;
+                    pos += 2;
+                    if (!parseHex(text, pos, lowSurrogate) || lowSurrogate < 0xDC00 || 0xE000 <= lowSurrogate)
+                        return false;
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+                }
+                appendUtf8(value, codePoint);
+                pos--;
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    inline bool parseScalar(const std::string& text, size_t& pos, std::string& value, Type& type)
+    {
+        if (pos < text.size() && text[pos] == '"')
+        {
+            type = STRING;
+            return parseString(text, pos, value);
+        }
+
+        const size_t start = pos;
+        while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']' && text[pos] != ' ' && text[pos] != '\t' && text[pos] != '\r' && text[pos] != '\n')
+            pos++;
+        value = text.substr(start, pos - start);
+        if (value == "true" || value == "false")
+        {
+            type = BOOLEAN;
+            return true;
+        }
+        if (value == "null")
+        {
+            type = NUL;
+            return true;
+        }
+
+        std::istringstream stream(value);
+        double number;
+        type = NUMBER;
+        return !value.empty() && (stream >> number) && stream.eof();
+    }
+
+    inline bool parseValue(const std::string& text, size_t& pos, std::string& value, Type& type)
+    {
+        if (pos >= text.size() || text[pos] != '[')
+            return parseScalar(text, pos, value, type);
+
+        //Array elements are joined with commas, nested arrays and objects are not supported
+        type = ARRAY;
+        value.clear();
+        pos++;
+        skipSpaces(text, pos);
+        if (pos < text.size() && text[pos] == ']')
+        {
+            pos++;
+            return true;
+        }
+        while (pos < text.size())
+        {
+            std::string element;
+            Type elementType;
+            if (text[pos] == '[' || text[pos] == '{' || !parseScalar(text, pos, element, elementType))
+                return false;
+            value += (value.empty() ? "" : ",") + element;
+            skipSpaces(text, pos);
+            if (pos < text.size() && text[pos] == ']')
+            {
+                pos++;
+                return true;
+            }
+            if (pos >= text.size() || text[pos] != ',')
+                return false;
+            pos++;
+            skipSpaces(text, pos);
+        }
+        return false;
+    }
+
+    inline bool parseObject(const std::string& text, std::vector<Member>& members)
+    {
+        members.clear();
+        size_t pos = 0;
+        skipSpaces(text, pos);
+        if (pos >= text.size() || text[pos] != '{')
+            return false;
+        pos++;
+        skipSpaces(text, pos);
+        if (pos < text.size() && text[pos] == '}')
+        {
+            pos++;
+            skipSpaces(text, pos);
+            return pos == text.size();
+        }
+
+        while (pos < text.size())
+        {
+            Member member;
+            if (!parseString(text, pos, member._key))
+                return false;
+            skipSpaces(text, pos);
+            if (pos >= text.size() || text[pos] != ':')
+                return false;
+            pos++;
+            skipSpaces(text, pos);
+            if (!parseValue(text, pos, member._value, member._type))
+                return false;
+            members.push_back(member);
+
+            skipSpaces(text, pos);
+            if (pos < text.size() && text[pos] == '}')
+            {
+                pos++;
+                skipSpaces(text, pos);
+                return pos == text.size();
+            }
+            if (pos >= text.size() || text[pos] != ',')
+                return false;
+            pos++;
+            skipSpaces(text, pos);
+        }
+        return false;
+    }
+
+    inline std::string escape(const std::string& value)
+    {
+        std::stringstream escaped;
+        escaped << '"';
+        for (const char c : value)
+        {
+            switch (c)
+            {
+            case '"': escaped << "\\\""; break;
+            case '\\': escaped << "\\\\"; break;
+            case '\n': escaped << "\\n"; break;
+            case '\r': escaped << "\\r"; break;
+            case '\t': escaped << "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20)
+                    escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+                else
+                    escaped << c;
+            }
+        }
+        escaped << '"';
+        return escaped.str();
+    }
+};
@@ -36,6 +36,7 @@ namespace Log
     public:
         void setStream(std::ostream* stream, bool owner);
         void setLevel(Level level);
+        bool isEnabled(Level level) const;
         Message log(Level level);
 
     private:
@@ -109,6 +110,11 @@ inline void Log::Logger::setLevel(Level level)
     _level = level;
 }
 
+inline bool Log::Logger::isEnabled(Level level) const
+{
+    return level >= _level;
+}
+
 inline Log::Message Log::Logger::log(Level level)
 {
     return Message(*this, level);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Tiles.h"
+#include "Photo.h"
 #include <tuple>
 #include <vector>
 #include <opencv2/opencv.hpp>
@@ -18,7 +19,8 @@ public:
 
 public:
     int getRequiredNbTiles();
-    void solve(const Tiles& tiles);
+    void solve(const Tiles& tiles, const Photo& photo);
+    void restore(const std::vector<int>& matchingIds);
     const std::vector<int>& getUniqueIds() const;
     int getMatchingId(int mosaicId) const;
 
@@ -53,6 +55,7 @@ private:
 private:
     const int _gridWidth;
     const int _gridHeight;
+    std::vector<double> _photoFeatures;
     std::vector<bool> _redundancyMask;
     int _redundancyMaskNbTiles;
     std::vector<int> _uniqueIds;
@@ -10,6 +10,8 @@ namespace MathUtils
     const double DoubleMax = std::numeric_limits<double>::max();
     const double DoubleEpsilon = std::numeric_limits<double>::epsilon();
     const int IntMax = std::numeric_limits<int>::max();
+    const double SymmetryTol = 1e-10;
+    const double ConditionTol = 1e-12;
 
     template <unsigned int N>
     using VectorNd = Eigen::Matrix<double, N, 1>;
@@ -17,12 +19,42 @@ namespace MathUtils
     template <unsigned int N>
     using MatrixNd = Eigen::Matrix<double, N, N>;
 
+    template <unsigned int N>
+    bool isSymmetric(const MatrixNd<N>& M)
+    {
+        return (M - M.transpose()).cwiseAbs().maxCoeff() <= SymmetryTol * M.cwiseAbs().maxCoeff();
+    }
+
+    template <unsigned int N>
+    bool isWellConditioned(const Eigen::LLT<MatrixNd<N>>& llt)
+    {
+        //Cholesky diagonal ratio is used as a cheap condition estimate
+        if (llt.info() != Eigen::Success)
+            return false;
+        const VectorNd<N> diagonal = llt.matrixLLT().diagonal();
+        const double ratio = diagonal.minCoeff() / diagonal.maxCoeff();
+        return ratio * ratio > ConditionTol;
+    }
+
     template <unsigned int N>
     double det(const MatrixNd<N>& M)
     {
+        if constexpr (N == 3)
+        {
+            if (isSymmetric<N>(M))
+            {
+                Eigen::LLT<MatrixNd<N>> llt(M);
+                if (isWellConditioned<N>(llt))
+                {
+                    const double diagProduct = llt.matrixLLT().diagonal().prod();
+                    return diagProduct * diagProduct;
+                }
+            }
+        }
+
         Eigen::JacobiSVD<MatrixNd<N>> svdM(M, Eigen::ComputeFullV | Eigen::ComputeFullU);
 
-        VectorNd<3> sValues = svdM.singularValues();
+        VectorNd<N> sValues = svdM.singularValues();
         double determinant = 1.;
         for (int i = 0; i < N; i++)
             if (abs(sValues(i)) > DoubleEpsilon)
@@ -31,9 +63,38 @@ namespace MathUtils
         return determinant;
     }
 
+    template <unsigned int N>
+    double logDet(const MatrixNd<N>& M)
+    {
+        if constexpr (N == 3)
+        {
+            if (isSymmetric<N>(M))
+            {
+                Eigen::LLT<MatrixNd<N>> llt(M);
+                if (isWellConditioned<N>(llt))
+                    return 2. * llt.matrixLLT().diagonal().array().log().sum();
+            }
+        }
+
+        return log(det<N>(M));
+    }
+
     template <unsigned int N>
     MatrixNd<N> inv(const MatrixNd<N>& M)
     {
+        if constexpr (N == 3)
+        {
+            if (isSymmetric<N>(M))
+            {
+                Eigen::LLT<MatrixNd<N>> llt(M);
+                if (isWellConditioned<N>(llt))
+                {
+                    MatrixNd<N> invM = llt.solve(MatrixNd<N>::Identity());
+                    return 0.5 * (invM + invM.transpose());
+                }
+            }
+        }
+
         Eigen::JacobiSVD<MatrixNd<N>> svdM(M, Eigen::ComputeFullV | Eigen::ComputeFullU);
 
         MatrixNd<N> invS = svdM.singularValues().asDiagonal();
@@ -47,6 +108,19 @@ namespace MathUtils
     template <unsigned int N>
     MatrixNd<N> sqrt(const MatrixNd<N>& M)
     {
+        if constexpr (N == 3)
+        {
+            if (isSymmetric<N>(M))
+            {
+                //Closed-form (trigonometric) symmetric eigen decomposition
+                Eigen::SelfAdjointEigenSolver<MatrixNd<N>> eigenM;
+                eigenM.computeDirect(0.5 * (M + M.transpose()));
+                const VectorNd<N>& eigenValues = eigenM.eigenvalues();
+                if (eigenM.info() == Eigen::Success && eigenValues(0) > ConditionTol * eigenValues(N - 1))
+                    return eigenM.eigenvectors() * eigenValues.cwiseSqrt().asDiagonal() * eigenM.eigenvectors().transpose();
+            }
+        }
+
         Eigen::JacobiSVD<MatrixNd<N>> svdM(M, Eigen::ComputeFullV | Eigen::ComputeFullU);
 
         MatrixNd<N> sqrtS = svdM.singularValues().asDiagonal();
@@ -56,6 +130,24 @@ namespace MathUtils
         return svdM.matrixU() * sqrtS * svdM.matrixV().transpose();
     }
 
+    template <unsigned int N>
+    double traceSqrt(const MatrixNd<N>& M)
+    {
+        if constexpr (N == 3)
+        {
+            if (isSymmetric<N>(M))
+            {
+                //Only eigenvalues are needed for the trace
+                Eigen::SelfAdjointEigenSolver<MatrixNd<N>> eigenM;
+                eigenM.computeDirect(0.5 * (M + M.transpose()), Eigen::EigenvaluesOnly);
+                if (eigenM.info() == Eigen::Success)
+                    return eigenM.eigenvalues().cwiseMax(0).cwiseSqrt().sum();
+            }
+        }
+
+        return sqrt<N>(M).trace();
+    }
+
     template <unsigned int N>
     MatrixNd<N> Cholesky(const MatrixNd<N>& M)
     {
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ProbaUtils.h"
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <map>
+#include <mutex>
+
+
+class ModelCache
+{
+public:
+    static const std::string CacheDir;
+
+private:
+    static constexpr unsigned int FileMagic = 0x4D474D50; //"PMGM"
+    static constexpr unsigned int FileVersion = 1;
+
+public:
+    ModelCache(const std::string& path);
+    ~ModelCache();
+
+public:
+    static std::string computeKey(const cv::Mat& tile);
+    bool load(const std::string& key, const ProbaUtils::Histogram<3>& histogram, ProbaUtils::GMMNDComponents<3>& gmm);
+    void store(const std::string& key, const ProbaUtils::Histogram<3>& histogram, const ProbaUtils::GMMNDComponents<3>& gmm);
+
+private:
+    struct Entry
+    {
+        int _nbData;
+        int _nbValues;
+        ProbaUtils::GMMNDComponents<3> _gmm;
+    };
+
+private:
+    bool createCache();
+    bool readEntry(const std::string& filePath, Entry& entry) const;
+    bool writeEntry(const std::string& filePath, const Entry& entry) const;
+
+private:
+    const std::string _cachePath;
+    std::mutex _mutex;
+    std::map<std::string, Entry> _entries;
+    bool _writable;
+};
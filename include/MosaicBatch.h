@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Parameters.h"
+#include "MosaicGenerator.h"
+#include "TileLibrary.h"
+#include "FaceDetectionROI.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+
+class MosaicBatch //Targets of a manifest share tiles folder scan, duplicate removal, face detection and tile computing
+{
+public:
+    MosaicBatch(const Parameters& parameters);
+    ~MosaicBatch();
+    void run();
+
+private:
+    struct Library
+    {
+        std::shared_ptr<TileLibrary> _library;
+        bool _preview;
+        std::vector<cv::Size> _tileSizes;
+    };
+
+    struct Target
+    {
+        int _line;
+        std::string _name;
+        Parameters _parameters;
+        std::string _libraryKey; //Empty in render mode
+        std::shared_ptr<MosaicGenerator> _generator;
+    };
+
+private:
+    void readManifest(const Parameters& parameters, std::vector<Parameters>& targets, std::vector<int>& lines) const;
+    void computeTiles();
+
+private:
+    std::shared_ptr<FaceDetectionROI> _roi; //Loaded once for all targets
+    std::shared_ptr<FaceDetectionROI> _previewROI; //Never loaded, preview crops are centered
+    std::map<std::string, Library> _libraries;
+    std::vector<Target> _targets;
+    std::vector<std::shared_ptr<const Tiles>> _computedTiles; //Kept until every target is built
+};
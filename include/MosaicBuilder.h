@@ -4,6 +4,11 @@
 #include "Tiles.h"
 #include "MatchSolver.h"
 #include "ProbaUtils.h"
+#include "ModelCache.h"
+#include "GaussianMixtureModel.h"
+#include "ColorTransfer.h"
+#include "MosaicWriter.h"
+#include "Checkpoint.h"
 #include <vector>
 #include <tuple>
 #include <opencv2/opencv.hpp>
@@ -13,30 +18,50 @@
 class MosaicBuilder
 {
 private:
+    using ColorModel = GaussianMixtureModel<3>; //Double precision SoA kernels, see the GMM bench of the test project for the float comparison
+
     static constexpr int MaxNbCompo = 10;
     static constexpr int NbInit = 20;
     static constexpr int MaxIter = 1000;
     static constexpr double ConvergenceTol = 1e-3;
     static constexpr double CovarianceReg = 1e-6;
-    static constexpr int ColorEnhancerNbSamples = 1e6;
-    static constexpr int MosaicParam[2] = {cv::IMWRITE_JPEG_QUALITY, 100};
+    static constexpr int CoresetMinValues = 4096;
+    static constexpr int CoresetRefineIter = 1;
+    static constexpr int BICPatience = 2;
+    static constexpr int SignatureBlocks = 4;
+    static constexpr int FingerprintBins = 4;
+    static constexpr int FingerprintLevels = 16;
+    static constexpr int ColorEnhancerNbSobolSamples = 1 << 18; //Sampling coverage error is measured by the test project bench
 
 public:
-    MosaicBuilder(std::tuple<int, int> grid, std::tuple<double, double, double> blending);
+    MosaicBuilder(std::tuple<int, int> grid, std::tuple<double, double, double> blending, int quantization, int cellTolerance, ColorTransfer::Engine colorEngine, int quality, MosaicWriter::Format format, const std::string& outputName);
     ~MosaicBuilder();
-    void build(const Photo& photo, const Tiles& tiles, const MatchSolver& matchSolver);
+    void build(const Photo& photo, const Tiles& tiles, const MatchSolver& matchSolver, ModelCache& modelCache, Checkpoint* checkpoint);
+    void render(const Photo& photo, Checkpoint& checkpoint);
+    void precompute(const Tiles& tiles, ModelCache& modelCache, int nbThreads);
+    std::string computeMosaicPattern(const std::string& path) const; //Mosaic paths with * in place of blending value
 
 private:
-    void copyTileOnMosaic(cv::Mat& mosaic, const cv::Mat& tile, int mosaicId, const cv::Rect& box);
-    void exportMosaic(const std::string& path, double blending, cv::Mat mosaic);
+    int computeNbSteps() const;
+    void copyTileOnBand(cv::Mat& band, const cv::Mat& tile, int column);
+    std::string computeMosaicPath(const std::string& path, double blending) const;
 
 private:
     struct TileData
     {
         ProbaUtils::Histogram<3> _histogram;
         ProbaUtils::GMMNDComponents<3> _gmm;
+        std::shared_ptr<const ColorTransfer::Source> _transferSource;
     };
 
+private:
+    void renderMosaics(const Photo& photo, const std::vector<int>& cellTiles, const std::vector<TileData>& tilesData, const std::vector<ProbaUtils::GMMNDComponents<3>>& photoTileGmm, const ProbaUtils::GMMSamplerDatas<3>& datas, std::vector<ColorTransfer::Model>& models, bool restoreModels);
+    bool computeTileData(TileData& tileData, const std::string& tilePath, ModelCache& modelCache, bool colorModel, ProbaUtils::GMMFitStats& stats);
+    void computeGmm(ProbaUtils::GMMNDComponents<3>& gmm, const ProbaUtils::Histogram<3>& histogram, int minNbComponents, ProbaUtils::GMMFitStats& stats) const;
+    void logModelStats(const std::string& phase, const ProbaUtils::GMMFitStats& stats) const;
+    void groupCells(std::vector<int>& representatives, const Photo& photo) const;
+    void computeCellSignature(std::vector<int>& signature, const cv::Mat& cell) const;
+
 private:
     std::shared_ptr<const Photo> _photo;
     const int _gridWidth;
@@ -44,5 +69,11 @@ private:
     const double _blendingStep;
     const double _blendingMin;
     const double _blendingMax;
+    const int _quantization;
+    const int _cellTolerance;
+    const ColorTransfer::Engine _colorEngine;
+    const int _quality;
+    const MosaicWriter::Format _format;
+    const std::string _outputName; //Mosaic files are named <outputName>_<blending>
 };
 
@@ -2,27 +2,49 @@
 
 #include "Parameters.h"
 #include "Photo.h"
-#include "ColorEnhancer.h"
+#include "ColorTransfer.h"
 #include "FaceDetectionROI.h"
 #include "Tiles.h"
-#include "DuplicateRemover.h"
+#include "TileLibrary.h"
 #include "MatchSolver.h"
 #include "MosaicBuilder.h"
+#include "Checkpoint.h"
 #include <memory>
 
 
 class MosaicGenerator
 {
+private:
+    static constexpr int PreviewTileSize = 32;
+    static constexpr int PreviewTileReduction = 8;
+    static constexpr ColorTransfer::Engine PreviewColorEngine = ColorTransfer::REINHARD;
+    static constexpr int PrecomputeThreadsDivisor = 4; //Background fits use a quarter of the threads
+    static const std::string CheckpointExtension;
+
 public:
-    MosaicGenerator(const Parameters& parameters);
+    MosaicGenerator(const Parameters& parameters, std::shared_ptr<TileLibrary> library = nullptr, std::shared_ptr<FaceDetectionROI> roi = nullptr);
     ~MosaicGenerator();
+    static int getTileReduction(const Parameters& parameters);
+    bool computeLibraryTileSize(cv::Size& tileSize) const;
+    std::string getOutputPattern() const;
+    std::string getOutputCheckpointPath() const; //Empty when no checkpoint is written
     void Build();
 
+private:
+    static std::string computeOutputName(const Parameters& parameters, bool preview);
+    void findPreviewCheckpoint(const Parameters& parameters);
+
 private:
     std::shared_ptr<Photo> _photo;
     std::shared_ptr<FaceDetectionROI> _roi;
-    std::shared_ptr<Tiles> _tiles;
-    std::shared_ptr<DuplicateRemover> _duplicateRemover;
+    std::shared_ptr<TileLibrary> _library;
+    std::shared_ptr<const Tiles> _tiles;
     std::shared_ptr<MatchSolver> _matchSolver;
     std::shared_ptr<MosaicBuilder> _mosaicBuilder;
+    std::shared_ptr<Checkpoint> _checkpoint;
+    std::shared_ptr<Checkpoint> _previewCheckpoint; //Preview whose tile matching is reused at full quality
+    const bool _precompute;
+    const bool _render;
+    const bool _preview;
+    std::string _checkpointPath;
 };
\ No newline at end of file
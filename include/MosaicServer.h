@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Parameters.h"
+#include "JsonUtils.h"
+#include "TileLibrary.h"
+#include "FaceDetectionROI.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+
+
+class MosaicServer //Jobs read as JSON lines on standard input, tile libraries and face detectors stay loaded between jobs
+{
+public:
+    MosaicServer(const Parameters& parameters);
+    ~MosaicServer();
+    void run();
+
+private:
+    struct Job
+    {
+        std::string _id;
+        std::string _user; //Users are served in turn, jobs of a user in arrival order
+        std::vector<std::string> _arguments;
+        std::chrono::steady_clock::time_point _receivedTime;
+    };
+
+private:
+    void initialize();
+    bool parseJob(const std::string& line, Job& job, std::string& error);
+    void pushJob(const Job& job);
+    bool popJob(Job& job);
+    void runWorker(int workerId);
+    bool runJob(const Job& job, int workerId, std::string& error);
+    std::shared_ptr<TileLibrary> getLibrary(const std::string& tilesPath, int reduction);
+    void report(const std::string& message);
+
+private:
+    const int _nbWorkers;
+    const int _nbWorkerThreads; //OpenMP threads per worker
+    const std::string _tilesPath;
+    std::vector<std::shared_ptr<FaceDetectionROI>> _rois; //One detector set per worker, detectors are indexed by OpenMP thread
+    std::mutex _libraryMutex;
+    std::map<std::string, std::shared_ptr<TileLibrary>> _libraries;
+    std::mutex _queueMutex;
+    std::condition_variable _queueCondition;
+    std::map<std::string, std::deque<Job>> _queues;
+    std::string _lastUser;
+    int _nbQueued;
+    int _nbRunning;
+    int _nbReceived;
+    bool _closed;
+    std::mutex _reportMutex;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+
+
+class MosaicWriter //Mosaic output fed with row bands from top to bottom, only a bounded number of rows is kept in memory
+{
+public:
+    enum Format
+    {
+        JPEG,
+        DEEP_ZOOM
+    };
+
+public:
+    static bool findFormat(const std::string& name, Format& format);
+    static std::string getExtension(Format format);
+    static std::unique_ptr<MosaicWriter> create(Format format, const std::string& path, const cv::Size& size, int quality);
+
+public:
+    virtual ~MosaicWriter() {};
+    virtual void write(const cv::Mat& band) = 0; //BGR rows, appended from top to bottom
+    virtual void finish() = 0;
+
+private:
+    static constexpr Format Formats[2] = {JPEG, DEEP_ZOOM};
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <mutex>
 #include <io.h>
 
 
@@ -24,6 +25,8 @@ public:
     inline void cstderr_restore();
 
 private:
+    std::mutex _mutex;
+    int _nbSilent = 0; //Concurrent jobs silence stderr until the last one restores it
     int _stderr = -1;
     FILE* _stream = nullptr;
 };
@@ -31,8 +34,8 @@ private:
 
 inline void OutputManager::cstderr_silent()
 {
-    
-    if (!_stream)
+    const std::lock_guard<std::mutex> lock(_mutex);
+    if (_nbSilent++ == 0 && !_stream)
     {
         fflush(stderr);
         _stderr = _dup(_fileno(stderr));
@@ -42,7 +45,8 @@ inline void OutputManager::cstderr_silent()
 
 inline void OutputManager::cstderr_restore()
 {
-    if (_stream)
+    const std::lock_guard<std::mutex> lock(_mutex);
+    if (_nbSilent > 0 && --_nbSilent == 0 && _stream)
     {
         fflush(stderr);
         _dup2(_stderr, _fileno(stderr));
@@ -4,6 +4,9 @@
 #include <optional>
 #include <tuple>
 #include "cxxopts.hpp"
+#include "JsonUtils.h"
+#include "ColorTransfer.h"
+#include "MosaicWriter.h"
 
 
 class Parameters
@@ -18,6 +21,22 @@ public:
 	double getScale() const;
 	std::tuple<int, int, bool> getResolution() const;
 	std::tuple<double, double, double> getBlending() const;
+	int getQuantization() const;
+	bool getPrecompute() const;
+	bool getVerbose() const;
+	int getCellTolerance() const;
+	ColorTransfer::Engine getColorEngine() const;
+	int getQuality() const;
+	MosaicWriter::Format getFormat() const;
+	std::string getCheckpointPath() const;
+	bool getRender() const;
+	bool getPreview() const;
+	bool getServer() const;
+	int getNbJobs() const;
+	std::string getBatchPath() const;
+	std::string getName() const;
+	Parameters createTarget(const std::vector<std::string>& arguments) const;
+	static void toArguments(const std::vector<JsonUtils::Member>& members, std::vector<std::string>& arguments);
 	std::string getHelp() const;
 
 private:
@@ -33,4 +52,18 @@ private:
 	std::optional<std::vector<int>> _resolution;
 	bool _crop = false;
 	std::optional<std::vector<double>> _blending;
+	std::optional<int> _quantization;
+	bool _precompute = false;
+	bool _verbose = false;
+	std::optional<int> _cellTolerance;
+	std::optional<std::string> _colorEngine;
+	std::optional<int> _quality;
+	std::optional<std::string> _format;
+	std::optional<std::string> _checkpointPath;
+	bool _render = false;
+	bool _preview = false;
+	bool _server = false;
+	std::optional<int> _nbJobs;
+	std::optional<std::string> _batchPath;
+	std::optional<std::string> _name;
 };
\ No newline at end of file
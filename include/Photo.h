@@ -12,17 +12,20 @@ private:
     static constexpr int MinTileSize = 32;
 
 public:
-    Photo(const std::string& path, std::tuple<int, int> grid, double scale, std::tuple<int, int, bool> resolution);
+    Photo(const std::string& path, std::tuple<int, int> grid, double scale, std::tuple<int, int, bool> resolution, int previewTileSize = 0);
     ~Photo() {};
 
 public:
     void initialize();
+    cv::Size computeTileSize() const;
     cv::Rect getTileBox(int mosaicId) const;
     cv::Size getTileSize() const;
     const cv::Mat& getTile(int mosaicId) const;
     std::string getDirectory() const;
 
 private:
+    void readImage(cv::Mat& image) const;
+    void computeSizes(const cv::Size& inputSize, cv::Size& resampleSize, cv::Size& targetSize, cv::Size& tileSize) const;
     void computeTile(const cv::Mat& photo, int mosaicId);
 
 private:
@@ -33,6 +36,7 @@ private:
     const int _resolutionWidth;
     const int _resolutionHeight;
     const bool _resolutionCrop;
+    const int _previewTileSize; //Smallest tile side of preview mosaics, 0 for full resolution
     std::vector<cv::Mat> _tiles;
     cv::Size _inputSize;
     cv::Size _tileSize;
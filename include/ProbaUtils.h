@@ -1,15 +1,33 @@
 #pragma once
 
 #include "MathUtils.h"
+#include "TransportSolver.h"
 #include <opencv2/opencv.hpp>
 #include "network_simplex_simple.h"
 #include <numbers>
 #include <vector>
 #include <random>
+#include <unordered_map>
 
 
 namespace ProbaUtils
 {
+    constexpr int SoABlockSize = 256;
+    constexpr int SoAReductionLanes = 8; //Independent partial sums, reductions vectorize under strict floating point
+    constexpr int TransportMaxSize = 16; //Larger W2 problems are solved by network simplex
+    constexpr int SobolBits = 32;
+    constexpr int SobolMaxDimensions = 8;
+    constexpr int SobolDegrees[SobolMaxDimensions] = {0, 1, 2, 3, 3, 4, 4, 5}; //Joe-Kuo primitive polynomials, first dimension is van der Corput
+    constexpr int SobolPolynomials[SobolMaxDimensions] = {0, 0, 1, 1, 2, 1, 4, 2};
+    constexpr int SobolInitialNumbers[SobolMaxDimensions][5] = {{1}, {1}, {1, 3}, {1, 3, 1}, {1, 1, 1}, {1, 1, 3, 3}, {1, 3, 5, 13}, {1, 1, 5, 5, 17}};
+
+    enum SamplerSequence
+    {
+        PSEUDO_RANDOM,
+        SOBOL
+    };
+
+    //Values stay in double : coreset bins hold non integer means and the GMM, color transfers and model cache read them directly
     template <unsigned int N>
     struct Histogram
     {
@@ -30,6 +48,32 @@ namespace ProbaUtils
     template <unsigned int N>
     using GMMNDComponents = std::vector<GaussianComponent<N>>;
 
+    struct GMMFitStats //Work counters of GMM fits, filled by the caller fits only
+    {
+        long long _kmeansDistances = 0;
+        long long _kmeansSkippedDistances = 0;
+        long long _EMFits = 0;
+        long long _EMIterations = 0;
+        long long _EMCappedFits = 0;
+
+        GMMFitStats& operator+=(const GMMFitStats& stats)
+        {
+            _kmeansDistances += stats._kmeansDistances;
+            _kmeansSkippedDistances += stats._kmeansSkippedDistances;
+            _EMFits += stats._EMFits;
+            _EMIterations += stats._EMIterations;
+            _EMCappedFits += stats._EMCappedFits;
+            return *this;
+        }
+    };
+
+    template <unsigned int N, typename T>
+    struct HistogramSoA
+    {
+        std::vector<T> _values[N]; //One contiguous array per dimension
+        std::vector<T> _counts;
+    };
+
     struct W2Coefficient
     {
         double _value;
@@ -39,6 +83,21 @@ namespace ProbaUtils
 
     using W2Minimizers = std::vector<W2Coefficient>;
 
+    template <unsigned int N>
+    struct GaussianTransport
+    {
+        MathUtils::VectorNd<N> _mean0;
+        MathUtils::VectorNd<N> _mean1;
+        MathUtils::MatrixNd<N> _covariance0;
+        MathUtils::MatrixNd<N> _map; //Bures optimal map, covariance1 = map * covariance0 * map
+        double _weight;
+        unsigned int _k;
+        unsigned int _l;
+    };
+
+    template <unsigned int N>
+    using GMMTransport = std::vector<GaussianTransport<N>>;
+
     template <unsigned int N>
     struct GMMSamplerData
     {
@@ -56,20 +115,55 @@ namespace ProbaUtils
     template <unsigned int N>
     void computeHistogram(Histogram<N>& histogram, const double* data, int nbData);
 
+    template <unsigned int N>
+    void computeHistogram(Histogram<N>& histogram, const uchar* data, int nbData); //8-bit data, values packed in 32-bit keys.
+
+    template <unsigned int N>
+    void computeQuantizedHistogram(Histogram<N>& quantized, const Histogram<N>& histogram, double step); //Weighted coreset, _mapId maps histogram values to quantized values.
+
     template <unsigned int N>
     void evalGaussianPDF(std::vector<double>& densities, std::vector<double>& norms, const std::vector<MathUtils::VectorNd<N>>& values, const GMMNDComponents<N>& gmm, bool normalizeDensities);
 
+    template <unsigned int N>
+    void evalGaussianPosteriors(std::vector<double>& posteriors, const std::vector<MathUtils::VectorNd<N>>& values, const GMMNDComponents<N>& gmm); //Log-sum-exp normalized, values far from every component get the posteriors of the closest ones.
+
+    template <unsigned int N, typename T>
+    void toSoA(HistogramSoA<N, T>& histogramSoA, const Histogram<N>& histogram);
+
+    template <unsigned int N, typename T>
+    void evalGaussianPDF(std::vector<T>& densities, std::vector<T>& norms, const HistogramSoA<N, T>& histogram, const GMMNDComponents<N>& gmm, bool normalizeDensities); //Component-major densities, loops run across histogram values.
+
+    template <typename T>
+    void accumulateLanes(T* lanes, const T* terms, int size); //Adds terms to SoAReductionLanes partial sums.
+
+    template <typename T>
+    T sumLanes(const T* lanes);
+
+    template <unsigned int N, typename T>
+    void computeGaussianStatistics(GMMNDComponents<N>& gmm, const std::vector<T>& resps, const HistogramSoA<N, T>& histogram); //Count weighted responsabilities sums (weights), means and covariances.
+
     template <unsigned int N>
     double computeGW2(const GaussianComponent<N>& gaussian0, const GaussianComponent<N>& gaussian1); //Wasserstein-2 distance between 2 Nd gaussians.
 
+    template <unsigned int N>
+    double computeGW2(const GaussianComponent<N>& gaussian0, const MathUtils::MatrixNd<N>& cov0Sqrt, const GaussianComponent<N>& gaussian1); //Same with precomputed first covariance square root.
+
     template <unsigned int N>
     double computeGmmW2(W2Minimizers& wstar, const GMMNDComponents<N>& gmm0, const GMMNDComponents<N>& gmm1); //Wasserstein-2 distance and coefficients between 2 Nd gmms.
 
+    template <unsigned int N>
+    void computeGmmTransport(GMMTransport<N>& transport, const GMMNDComponents<N>& gmm0, const GMMNDComponents<N>& gmm1, const W2Minimizers& wstar); //Transport maps between W2 coupled components, independent of interpolation time.
+
+    template <unsigned int N>
+    void computeGmmInterpolation(GMMNDComponents<N>& gmmt, double t, const GMMTransport<N>& transport); //Gaussian interpolation from precomputed transport maps.
+
     template <unsigned int N>
     void computeGmmInterpolation(GMMNDComponents<N>& gmmt, double t, const GMMNDComponents<N>& gmm0, const GMMNDComponents<N>& gmm1, const W2Minimizers& wstar); //Gaussian interpolation between two Nd gmms.
 
+    double inverseNormalCDF(double p); //Acklam rational approximation, relative error below 1.2e-9.
+
     template <unsigned int N>
-    void generateGMMSamplerDatas(GMMSamplerDatas<N>& datas, int nbSamples, bool defaultSeed);
+    void generateGMMSamplerDatas(GMMSamplerDatas<N>& datas, int nbSamples, SamplerSequence sequence, bool defaultSeed); //Sobol sequence is scrambled with a random digital shift.
 
     template <unsigned int N>
     void computeGmmSamples(GMMSamples<N>& samples, const GMMNDComponents<N>& gmm, const GMMSamplerDatas<N>& datas);
@@ -116,6 +210,99 @@ void ProbaUtils::computeHistogram(Histogram<N>& histogram, const double* data, i
     histogram._nbData = nbData;
 }
 
+template<unsigned int N>
+void ProbaUtils::computeHistogram(Histogram<N>& histogram, const uchar* data, int nbData)
+{
+    static_assert(N <= 4, "Packed histogram keys are limited to 4 channels.");
+
+    //Open addressing hash table with linear probing, buffers are reused between calls of a same thread
+    thread_local std::vector<int> table;
+    thread_local std::vector<unsigned int> keys;
+    thread_local std::vector<unsigned int> slots;
+
+    int shift = 32;
+    unsigned int capacity = 1;
+    while (capacity < 2 * (unsigned int)nbData)
+    {
+        capacity <<= 1;
+        shift--;
+    }
+    const unsigned int mask = capacity - 1;
+    if (table.size() < capacity)
+        table.resize(capacity, -1);
+    keys.clear();
+    slots.clear();
+
+    histogram._mapId.resize(nbData);
+    histogram._counts.clear();
+    for (int i = 0; i < nbData; i++)
+    {
+        unsigned int key = 0;
+        for (int n = 0; n < N; n++)
+            key |= (unsigned int)data[i * N + n] << (8 * n);
+
+        unsigned int slot = shift < 32 ? (key * 0x9E3779B1u) >> shift : 0;
+        while (table[slot] >= 0 && keys[table[slot]] != key)
+            slot = (slot + 1) & mask;
+
+        if (table[slot] < 0)
+        {
+            table[slot] = keys.size();
+            keys.emplace_back(key);
+            slots.emplace_back(slot);
+            histogram._counts.emplace_back(0);
+        }
+
+        histogram._counts[table[slot]]++;
+        histogram._mapId[i] = table[slot];
+    }
+
+    const int nbValues = keys.size();
+    histogram._values.resize(nbValues);
+    for (int v = 0; v < nbValues; v++)
+        for (int n = 0; n < N; n++)
+            histogram._values[v](n, 0) = (double)((keys[v] >> (8 * n)) & 0xFF);
+    histogram._nbData = nbData;
+
+    for (unsigned int slot : slots)
+        table[slot] = -1;
+}
+
+template<unsigned int N>
+void ProbaUtils::computeQuantizedHistogram(Histogram<N>& quantized, const Histogram<N>& histogram, double step)
+{
+    const int nbValues = histogram._values.size();
+    const double invStep = 1. / step;
+    std::unordered_map<long long, int> cellIds;
+    cellIds.reserve(nbValues);
+
+    quantized._mapId.resize(nbValues);
+    quantized._values.clear();
+    quantized._counts.clear();
+    for (int v = 0; v < nbValues; v++)
+    {
+        long long cell = 0;
+        for (int n = 0; n < N; n++)
+            cell = (cell << 16) | ((long long)std::floor(histogram._values[v](n, 0) * invStep) & 0xFFFF);
+
+        auto [it, inserted] = cellIds.try_emplace(cell, (int)quantized._values.size());
+        if (inserted)
+        {
+            quantized._values.emplace_back(MathUtils::VectorNd<N>::Zero());
+            quantized._counts.emplace_back(0);
+        }
+
+        //Quantized value is the count weighted mean of the cell
+        quantized._values[it->second] += histogram._values[v] * (double)histogram._counts[v];
+        quantized._counts[it->second] += histogram._counts[v];
+        quantized._mapId[v] = it->second;
+    }
+
+    for (int q = 0; q < quantized._values.size(); q++)
+        quantized._values[q] /= (double)quantized._counts[q];
+    quantized._nbData = histogram._nbData;
+}
+
 template <unsigned int N>
 void ProbaUtils::evalGaussianPDF(std::vector<double>& densities, std::vector<double>& norms, const std::vector<MathUtils::VectorNd<N>>& values, const GMMNDComponents<N>& gmm, bool normalizeDensities)
 {
@@ -126,7 +313,7 @@ void ProbaUtils::evalGaussianPDF(std::vector<double>& densities, std::vector<dou
     for (int c = 0; c < nbComponents; c++)
     {
         halfCovInv[c] = 0.5 * MathUtils::inv<N>(gmm[c]._covariance);
-        constLog[c] = -0.5 * N * log(2. * std::numbers::pi) - 0.5 * log(MathUtils::det<N>(gmm[c]._covariance)) + log(gmm[c]._weight);
+        constLog[c] = -0.5 * N * log(2. * std::numbers::pi) - 0.5 * MathUtils::logDet<N>(gmm[c]._covariance) + log(gmm[c]._weight);
     }
 
     MathUtils::VectorNd<N> valMeanDiff;
@@ -164,13 +351,238 @@ void ProbaUtils::evalGaussianPDF(std::vector<double>& densities, std::vector<dou
     }
 }
 
+template <unsigned int N>
+void ProbaUtils::evalGaussianPosteriors(std::vector<double>& posteriors, const std::vector<MathUtils::VectorNd<N>>& values, const GMMNDComponents<N>& gmm)
+{
+    const int nbValues = values.size();
+    const int nbComponents = gmm.size();
+    std::vector<MathUtils::MatrixNd<N>> halfCovInv(nbComponents);
+    std::vector<double> constLog(nbComponents);
+    for (int c = 0; c < nbComponents; c++)
+    {
+        halfCovInv[c] = 0.5 * MathUtils::inv<N>(gmm[c]._covariance);
+        constLog[c] = -0.5 * N * log(2. * std::numbers::pi) - 0.5 * MathUtils::logDet<N>(gmm[c]._covariance) + log(gmm[c]._weight);
+    }
+
+    posteriors.resize(nbValues * nbComponents);
+    MathUtils::VectorNd<N> valMeanDiff;
+    for (int b = 0, e = 0; b < nbValues; b++, e += nbComponents)
+    {
+        double maxLogDensity = -MathUtils::DoubleMax;
+        for (int c = 0; c < nbComponents; c++)
+        {
+            valMeanDiff = values[b] - gmm[c]._mean;
+            posteriors[e + c] = constLog[c] - valMeanDiff.dot(halfCovInv[c] * valMeanDiff);
+            maxLogDensity = std::max(maxLogDensity, posteriors[e + c]);
+        }
+
+        //Largest term is exp(0), the sum never vanishes
+        double sum = 0;
+        for (int c = 0; c < nbComponents; c++)
+        {
+            posteriors[e + c] = exp(posteriors[e + c] - maxLogDensity);
+            sum += posteriors[e + c];
+        }
+        for (int c = 0; c < nbComponents; c++)
+            posteriors[e + c] /= sum;
+    }
+}
+
+template<unsigned int N, typename T>
+void ProbaUtils::toSoA(HistogramSoA<N, T>& histogramSoA, const Histogram<N>& histogram)
+{
+    const int nbValues = histogram._values.size();
+    for (int i = 0; i < N; i++)
+        histogramSoA._values[i].resize(nbValues);
+    histogramSoA._counts.resize(nbValues);
+
+    for (int b = 0; b < nbValues; b++)
+    {
+        for (int i = 0; i < N; i++)
+            histogramSoA._values[i][b] = (T)histogram._values[b](i);
+        histogramSoA._counts[b] = (T)histogram._counts[b];
+    }
+}
+
+template<unsigned int N, typename T>
+void ProbaUtils::evalGaussianPDF(std::vector<T>& densities, std::vector<T>& norms, const HistogramSoA<N, T>& histogram, const GMMNDComponents<N>& gmm, bool normalizeDensities)
+{
+    constexpr int NbCoeffs = N * (N + 1) / 2;
+    const T epsilon = (T)MathUtils::DoubleEpsilon;
+    const int nbValues = histogram._counts.size();
+    const int nbComponents = gmm.size();
+
+    const T* values[N];
+    for (int i = 0; i < N; i++)
+        values[i] = histogram._values[i].data();
+
+    T* normsData = norms.data();
+    std::fill(norms.begin(), norms.begin() + nbValues, (T)0);
+
+    for (int c = 0; c < nbComponents; c++)
+    {
+        //Component constants : mean, upper half of the quadratic form (off diagonal terms doubled) and log constant
+        const MathUtils::MatrixNd<N> halfCovInv = 0.5 * MathUtils::inv<N>(gmm[c]._covariance);
+        const T constLog = (T)(-0.5 * N * log(2. * std::numbers::pi) - 0.5 * MathUtils::logDet<N>(gmm[c]._covariance) + log(gmm[c]._weight));
+        T mean[N];
+        T coeffs[NbCoeffs];
+        for (int i = 0, k = 0; i < N; i++)
+        {
+            mean[i] = (T)gmm[c]._mean(i);
+            for (int j = i; j < N; j++, k++)
+                coeffs[k] = (T)((i == j ? 1. : 2.) * halfCovInv(i, j));
+        }
+
+        //Values are processed by blocks, innermost loops run over contiguous values
+        for (int b0 = 0; b0 < nbValues; b0 += SoABlockSize)
+        {
+            const int blockSize = std::min(SoABlockSize, nbValues - b0);
+            T* density = densities.data() + c * nbValues + b0;
+            T* norm = normsData + b0;
+            T diff[N][SoABlockSize];
+
+            for (int i = 0; i < N; i++)
+                for (int b = 0; b < blockSize; b++)
+                    diff[i][b] = values[i][b0 + b] - mean[i];
+
+            for (int b = 0; b < blockSize; b++)
+                density[b] = constLog;
+
+            for (int i = 0, k = 0; i < N; i++)
+                for (int j = i; j < N; j++, k++)
+                    for (int b = 0; b < blockSize; b++)
+                        density[b] -= coeffs[k] * diff[i][b] * diff[j][b];
+
+            for (int b = 0; b < blockSize; b++)
+                density[b] = std::exp(density[b]);
+
+            for (int b = 0; b < blockSize; b++)
+            {
+                density[b] = density[b] < epsilon ? (T)0 : density[b];
+                norm[b] += density[b];
+            }
+        }
+    }
+
+    for (int b = 0; b < nbValues; b++)
+        normsData[b] = normsData[b] == 0 ? epsilon : normsData[b];
+
+    if (normalizeDensities)
+    {
+        for (int c = 0; c < nbComponents; c++)
+        {
+            T* density = densities.data() + c * nbValues;
+            for (int b = 0; b < nbValues; b++)
+                density[b] /= normsData[b];
+        }
+    }
+}
+
+template<typename T>
+void ProbaUtils::accumulateLanes(T* lanes, const T* terms, int size)
+{
+    int b = 0;
+    for (; b + SoAReductionLanes <= size; b += SoAReductionLanes)
+        for (int l = 0; l < SoAReductionLanes; l++)
+            lanes[l] += terms[b + l];
+    for (int l = 0; b < size; b++, l++)
+        lanes[l] += terms[b];
+}
+
+template<typename T>
+T ProbaUtils::sumLanes(const T* lanes)
+{
+    T sum = 0;
+    for (int l = 0; l < SoAReductionLanes; l++)
+        sum += lanes[l];
+    return sum;
+}
+
+template<unsigned int N, typename T>
+void ProbaUtils::computeGaussianStatistics(GMMNDComponents<N>& gmm, const std::vector<T>& resps, const HistogramSoA<N, T>& histogram)
+{
+    constexpr int NbCoeffs = N * (N + 1) / 2;
+    const int nbValues = histogram._counts.size();
+    const int nbComponents = gmm.size();
+
+    const T* values[N];
+    for (int i = 0; i < N; i++)
+        values[i] = histogram._values[i].data();
+    const T* counts = histogram._counts.data();
+
+    for (int c = 0; c < nbComponents; c++)
+    {
+        const T* resp = resps.data() + c * nbValues;
+
+        //Values are processed by blocks, innermost loops run over contiguous values, sums are kept per lane
+        T weightLanes[SoAReductionLanes] = {};
+        T meanLanes[N][SoAReductionLanes] = {};
+        T weightedResp[SoABlockSize];
+        T terms[SoABlockSize];
+        for (int b0 = 0; b0 < nbValues; b0 += SoABlockSize)
+        {
+            const int blockSize = std::min(SoABlockSize, nbValues - b0);
+            for (int b = 0; b < blockSize; b++)
+                weightedResp[b] = resp[b0 + b] * counts[b0 + b];
+            accumulateLanes(weightLanes, weightedResp, blockSize);
+            for (int i = 0; i < N; i++)
+            {
+                for (int b = 0; b < blockSize; b++)
+                    terms[b] = weightedResp[b] * values[i][b0 + b];
+                accumulateLanes(meanLanes[i], terms, blockSize);
+            }
+        }
+        const T weight = sumLanes(weightLanes);
+        T mean[N];
+        for (int i = 0; i < N; i++)
+            mean[i] = sumLanes(meanLanes[i]) / weight;
+
+        T covarianceLanes[NbCoeffs][SoAReductionLanes] = {};
+        T diff[N][SoABlockSize];
+        for (int b0 = 0; b0 < nbValues; b0 += SoABlockSize)
+        {
+            const int blockSize = std::min(SoABlockSize, nbValues - b0);
+            for (int b = 0; b < blockSize; b++)
+                weightedResp[b] = resp[b0 + b] * counts[b0 + b];
+            for (int i = 0; i < N; i++)
+                for (int b = 0; b < blockSize; b++)
+                    diff[i][b] = values[i][b0 + b] - mean[i];
+            for (int i = 0, k = 0; i < N; i++)
+            {
+                for (int j = i; j < N; j++, k++)
+                {
+                    for (int b = 0; b < blockSize; b++)
+                        terms[b] = weightedResp[b] * diff[i][b] * diff[j][b];
+                    accumulateLanes(covarianceLanes[k], terms, blockSize);
+                }
+            }
+        }
+
+        gmm[c]._weight = (double)weight;
+        for (int i = 0, k = 0; i < N; i++)
+        {
+            gmm[c]._mean(i) = (double)mean[i];
+            for (int j = i; j < N; j++, k++)
+            {
+                gmm[c]._covariance(i, j) = (double)(sumLanes(covarianceLanes[k]) / weight);
+                gmm[c]._covariance(j, i) = gmm[c]._covariance(i, j);
+            }
+        }
+    }
+}
+
 template<unsigned int N>
 double ProbaUtils::computeGW2(const GaussianComponent<N>& gaussian0, const GaussianComponent<N>& gaussian1)
+{
+    return computeGW2<N>(gaussian0, MathUtils::sqrt<N>(gaussian0._covariance), gaussian1);
+}
+
+template<unsigned int N>
+double ProbaUtils::computeGW2(const GaussianComponent<N>& gaussian0, const MathUtils::MatrixNd<N>& cov0Sqrt, const GaussianComponent<N>& gaussian1)
 {
     MathUtils::VectorNd<N> gaussianDiff = gaussian1._mean - gaussian0._mean;
-    MathUtils::MatrixNd<N> cov0Sqrt = MathUtils::sqrt<N>(gaussian0._covariance);
 
-    return gaussianDiff.dot(gaussianDiff) + (gaussian0._covariance + gaussian1._covariance - 2. * MathUtils::sqrt<N>(cov0Sqrt * gaussian1._covariance * cov0Sqrt)).trace();
+    return gaussianDiff.dot(gaussianDiff) + (gaussian0._covariance + gaussian1._covariance).trace() - 2. * MathUtils::traceSqrt<N>(cov0Sqrt * gaussian1._covariance * cov0Sqrt);
 }
 
 template<unsigned int N>
@@ -180,33 +592,58 @@ double ProbaUtils::computeGmmW2(W2Minimizers& wstar, const GMMNDComponents<N>& g
     unsigned int K1 = gmm1.size();
     std::vector<double> weights0(K0);
     std::vector<double> weights1(K1);
-
-    lemon::FullBipartiteDigraph digraph(K0, K1);
-    lemon::NetworkSimplexSimple<lemon::FullBipartiteDigraph, double, double, int> network(digraph, false, K0 + K1, K0 * K1);
+    std::vector<double> costs(K0 * K1);
+    std::vector<double> flows(K0 * K1);
 
     for (int k = 0; k < K0; k++)
         weights0[k] = gmm0[k]._weight;
 
     for (int l = 0; l < K1; l++)
-        weights1[l] = -gmm1[l]._weight;
-
-    network.supplyMap(weights0.data(), K0, weights1.data(), K1);
+        weights1[l] = gmm1[l]._weight;
 
+    //First component square roots are shared by all pairs
     for (int k = 0, i = 0; k < K0; k++)
+    {
+        const MathUtils::MatrixNd<N> cov0Sqrt = MathUtils::sqrt<N>(gmm0[k]._covariance);
         for (int l = 0; l < K1; l++, i++)
-            network.setCost(i, computeGW2(gmm0[k], gmm1[l]));
+            costs[i] = computeGW2<N>(gmm0[k], cov0Sqrt, gmm1[l]);
+    }
 
-    int ret = network.run();
-    double distance = network.totalCost();
+    double distance = 0;
+    TransportSolver<TransportMaxSize> solver;
+    if (solver.run(weights0.data(), K0, weights1.data(), K1, costs.data()))
+    {
+        distance = solver.getCost();
+        for (int k = 0, i = 0; k < K0; k++)
+            for (int l = 0; l < K1; l++, i++)
+                flows[i] = solver.getFlow(k, l);
+    }
+    else
+    {
+        lemon::FullBipartiteDigraph digraph(K0, K1);
+        lemon::NetworkSimplexSimple<lemon::FullBipartiteDigraph, double, double, int> network(digraph, false, K0 + K1, K0 * K1);
+
+        for (int l = 0; l < K1; l++)
+            weights1[l] = -weights1[l];
+
+        network.supplyMap(weights0.data(), K0, weights1.data(), K1);
+
+        for (int i = 0; i < K0 * K1; i++)
+            network.setCost(i, costs[i]);
+
+        int ret = network.run();
+        distance = network.totalCost();
+        for (int i = 0; i < K0 * K1; i++)
+            flows[i] = network.flow(i);
+    }
 
     wstar.reserve(K0 + K1 - 1);
     for (int k = 0, i = 0; k < K0; k++)
     {
         for (int l = 0; l < K1; l++, i++)
         {
-            double flow = network.flow(i);
-            if (abs(flow) > MathUtils::DoubleEpsilon)
-                wstar.emplace_back(flow, k, l);
+            if (abs(flows[i]) > MathUtils::DoubleEpsilon)
+                wstar.emplace_back(flows[i], k, l);
         }
     }
 
@@ -214,42 +651,140 @@ double ProbaUtils::computeGmmW2(W2Minimizers& wstar, const GMMNDComponents<N>& g
 }
 
 template<unsigned int N>
-void ProbaUtils::computeGmmInterpolation(GMMNDComponents<N>& gmmt, double t, const GMMNDComponents<N>& gmm0, const GMMNDComponents<N>& gmm1, const W2Minimizers& wstar)
+void ProbaUtils::computeGmmTransport(GMMTransport<N>& transport, const GMMNDComponents<N>& gmm0, const GMMNDComponents<N>& gmm1, const W2Minimizers& wstar)
 {
     const int nbComponents = wstar.size();
-    gmmt.resize(nbComponents);
-
-    std::vector<MathUtils::VectorNd<N>> meanT(nbComponents);
+    transport.resize(nbComponents);
 
     for (int c = 0; c < nbComponents; c++)
     {
-        double k = wstar[c]._k;
-        double l = wstar[c]._l;
+        const unsigned int k = wstar[c]._k;
+        const unsigned int l = wstar[c]._l;
 
-        gmmt[c]._mean = (1. - t) * gmm0[k]._mean + t * gmm1[l]._mean;
         const MathUtils::MatrixNd<N>& sigma0 = gmm0[k]._covariance;
         const MathUtils::MatrixNd<N>& sigma1 = gmm1[l]._covariance;
         const MathUtils::MatrixNd<N> sigma1Sqrt = MathUtils::sqrt<N>(sigma1);
-        const MathUtils::MatrixNd<N> C = sigma1Sqrt * MathUtils::sqrt<N>(MathUtils::inv<N>(sigma1Sqrt * sigma0 * sigma1Sqrt)) * sigma1Sqrt;
-        const MathUtils::MatrixNd<N> Cinterp = (1 - t) * MathUtils::MatrixNd<N>::Identity() + t * C;
-        gmmt[c]._covariance = Cinterp * sigma0 * Cinterp;
-        gmmt[c]._weight = wstar[c]._value;
+        transport[c]._map = sigma1Sqrt * MathUtils::sqrt<N>(MathUtils::inv<N>(sigma1Sqrt * sigma0 * sigma1Sqrt)) * sigma1Sqrt;
+        transport[c]._mean0 = gmm0[k]._mean;
+        transport[c]._mean1 = gmm1[l]._mean;
+        transport[c]._covariance0 = sigma0;
+        transport[c]._weight = wstar[c]._value;
+        transport[c]._k = k;
+        transport[c]._l = l;
+    }
+}
+
+template<unsigned int N>
+void ProbaUtils::computeGmmInterpolation(GMMNDComponents<N>& gmmt, double t, const GMMTransport<N>& transport)
+{
+    const int nbComponents = transport.size();
+    gmmt.resize(nbComponents);
+
+    for (int c = 0; c < nbComponents; c++)
+    {
+        const MathUtils::MatrixNd<N> Cinterp = (1 - t) * MathUtils::MatrixNd<N>::Identity() + t * transport[c]._map;
+        gmmt[c]._mean = (1. - t) * transport[c]._mean0 + t * transport[c]._mean1;
+        gmmt[c]._covariance = Cinterp * transport[c]._covariance0 * Cinterp;
+        gmmt[c]._weight = transport[c]._weight;
+    }
+}
+
+template<unsigned int N>
+void ProbaUtils::computeGmmInterpolation(GMMNDComponents<N>& gmmt, double t, const GMMNDComponents<N>& gmm0, const GMMNDComponents<N>& gmm1, const W2Minimizers& wstar)
+{
+    GMMTransport<N> transport;
+    computeGmmTransport<N>(transport, gmm0, gmm1, wstar);
+    computeGmmInterpolation<N>(gmmt, t, transport);
+}
+
+inline double ProbaUtils::inverseNormalCDF(double p)
+{
+    static constexpr double a[6] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static constexpr double b[5] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01};
+    static constexpr double c[6] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static constexpr double d[4] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00};
+    static constexpr double pLow = 0.02425;
+
+    if (p < pLow)
+    {
+        const double q = std::sqrt(-2 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
     }
+    if (p > 1 - pLow)
+    {
+        const double q = std::sqrt(-2 * std::log(1 - p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+
+    const double q = p - 0.5;
+    const double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
 }
 
 template<unsigned int N>
-void ProbaUtils::generateGMMSamplerDatas(GMMSamplerDatas<N>& datas, int nbSamples, bool defaultSeed)
+void ProbaUtils::generateGMMSamplerDatas(GMMSamplerDatas<N>& datas, int nbSamples, SamplerSequence sequence, bool defaultSeed)
 {
     std::unique_ptr<std::mt19937> gen = defaultSeed ? std::make_unique<std::mt19937>() : std::make_unique<std::mt19937>(std::random_device{}());
-    std::uniform_real_distribution<double> uniform(0.0, 1.0);
-    std::normal_distribution<double> normal(0.0, 1.0);
     datas.resize(nbSamples);
 
-    for (int s = 0; s < nbSamples; s++)
+    if (sequence == SOBOL)
     {
-        datas[s]._component = uniform(*gen.get());
-        for (int n = 0; n < N; n++)
-            datas[s]._stdGaussian(n, 0) = normal(*gen.get());
+        static_assert(N + 1 <= SobolMaxDimensions, "Sobol direction numbers are not available for this dimension.");
+        constexpr int nbDimensions = N + 1;
+
+        //Direction numbers and random digital shift for each dimension
+        uint32_t directions[nbDimensions][SobolBits];
+        uint32_t points[nbDimensions];
+        for (int d = 0; d < nbDimensions; d++)
+        {
+            const int degree = SobolDegrees[d];
+            for (int i = 0; i < SobolBits; i++)
+            {
+                if (d == 0 || i < degree)
+                {
+                    const uint32_t initial = (d == 0) ? 1 : SobolInitialNumbers[d][i];
+                    directions[d][i] = initial << (SobolBits - 1 - i);
+                }
+                else
+                {
+                    directions[d][i] = directions[d][i - degree] ^ (directions[d][i - degree] >> degree);
+                    for (int k = 1; k < degree; k++)
+                        if ((SobolPolynomials[d] >> (degree - 1 - k)) & 1)
+                            directions[d][i] ^= directions[d][i - k];
+                }
+            }
+            points[d] = (uint32_t)(*gen.get())();
+        }
+
+        //Gray code ordering, each point differs from the previous one by a single direction number
+        const double scale = 1. / 4294967296.;
+        for (int s = 0; s < nbSamples; s++)
+        {
+            if (s > 0)
+            {
+                int bit = 0;
+                for (uint32_t index = (uint32_t)s; !(index & 1); index >>= 1)
+                    bit++;
+                for (int d = 0; d < nbDimensions; d++)
+                    points[d] ^= directions[d][bit];
+            }
+
+            datas[s]._component = (points[0] + 0.5) * scale;
+            for (int n = 0; n < N; n++)
+                datas[s]._stdGaussian(n, 0) = inverseNormalCDF((points[n + 1] + 0.5) * scale);
+        }
+    }
+    else
+    {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::normal_distribution<double> normal(0.0, 1.0);
+
+        for (int s = 0; s < nbSamples; s++)
+        {
+            datas[s]._component = uniform(*gen.get());
+            for (int n = 0; n < N; n++)
+                datas[s]._stdGaussian(n, 0) = normal(*gen.get());
+        }
     }
 
     std::sort(datas.begin(), datas.end(), [](const GMMSamplerData<N> lhs, const GMMSamplerData<N> rhs) { return lhs._component < rhs._component; });
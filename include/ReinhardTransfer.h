@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ColorTransfer.h"
+#include "MathUtils.h"
+#include "ProbaUtils.h"
+#include <vector>
+
+
+class ReinhardTransfer : public ColorTransfer //Mean and standard deviation matching in Lab space
+{
+private:
+    static constexpr double MinDeviation = 1e-3;
+
+public:
+    class Source : public ColorTransfer::Source
+    {
+        friend class ReinhardTransfer;
+
+    public:
+        Source(const ProbaUtils::Histogram<3>& histogram);
+        ~Source();
+
+    private:
+        const ProbaUtils::Histogram<3>& _histogram;
+        std::vector<MathUtils::VectorNd<3>> _labValues;
+        MathUtils::VectorNd<3> _mean;
+        MathUtils::VectorNd<3> _deviation;
+    };
+
+public:
+    static CostProfile getCostProfile();
+
+public:
+    ReinhardTransfer(const Source& source, const cv::Mat& cell);
+    ~ReinhardTransfer();
+
+public:
+    void apply(cv::Mat& enhancedImage, double blending) override;
+
+private:
+    static void computeLabStatistics(MathUtils::VectorNd<3>& mean, MathUtils::VectorNd<3>& deviation, std::vector<MathUtils::VectorNd<3>>& labValues, const ProbaUtils::Histogram<3>& histogram);
+
+private:
+    const Source& _source;
+    MathUtils::VectorNd<3> _targetMean;
+    MathUtils::VectorNd<3> _targetDeviation;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "ProbaUtils.h"
+#include <fstream>
+#include <string>
+
+
+namespace SerializationUtils
+{
+    template <typename T>
+    void writeValue(std::ofstream& stream, const T& value);
+
+    template <typename T>
+    bool readValue(std::ifstream& stream, T& value);
+
+    inline void writeString(std::ofstream& stream, const std::string& value)
+    {
+        writeValue(stream, (int)value.size());
+        stream.write(value.data(), value.size());
+    }
+
+    inline bool readString(std::ifstream& stream, std::string& value)
+    {
+        int size = 0;
+        if (!readValue(stream, size) || size < 0)
+            return false;
+        value.resize(size);
+        stream.read(value.data(), size);
+        return stream.good();
+    }
+
+    template <unsigned int N>
+    void writeGmm(std::ofstream& stream, const ProbaUtils::GMMNDComponents<N>& gmm);
+
+    template <unsigned int N>
+    bool readGmm(std::ifstream& stream, ProbaUtils::GMMNDComponents<N>& gmm);
+
+    template <unsigned int N>
+    void writeGmmTransport(std::ofstream& stream, const ProbaUtils::GMMTransport<N>& transport);
+
+    template <unsigned int N>
+    bool readGmmTransport(std::ifstream& stream, ProbaUtils::GMMTransport<N>& transport);
+};
+
+
+template <typename T>
+void SerializationUtils::writeValue(std::ofstream& stream, const T& value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool SerializationUtils::readValue(std::ifstream& stream, T& value)
+{
+    stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return stream.good();
+}
+
+template <unsigned int N>
+void SerializationUtils::writeGmm(std::ofstream& stream, const ProbaUtils::GMMNDComponents<N>& gmm)
+{
+    writeValue(stream, (int)gmm.size());
+    for (const auto& component : gmm)
+    {
+        writeValue(stream, component._weight);
+        stream.write(reinterpret_cast<const char*>(component._mean.data()), sizeof(double) * N);
+        stream.write(reinterpret_cast<const char*>(component._covariance.data()), sizeof(double) * N * N);
+    }
+}
+
+template <unsigned int N>
+bool SerializationUtils::readGmm(std::ifstream& stream, ProbaUtils::GMMNDComponents<N>& gmm)
+{
+    int nbComponents = 0;
+    if (!readValue(stream, nbComponents) || nbComponents < 0)
+        return false;
+
+    gmm.resize(nbComponents);
+    for (auto& component : gmm)
+    {
+        if (!readValue(stream, component._weight))
+            return false;
+        stream.read(reinterpret_cast<char*>(component._mean.data()), sizeof(double) * N);
+        stream.read(reinterpret_cast<char*>(component._covariance.data()), sizeof(double) * N * N);
+        if (!stream.good())
+            return false;
+    }
+    return true;
+}
+
+template <unsigned int N>
+void SerializationUtils::writeGmmTransport(std::ofstream& stream, const ProbaUtils::GMMTransport<N>& transport)
+{
+    writeValue(stream, (int)transport.size());
+    for (const auto& gaussianTransport : transport)
+    {
+        stream.write(reinterpret_cast<const char*>(gaussianTransport._mean0.data()), sizeof(double) * N);
+        stream.write(reinterpret_cast<const char*>(gaussianTransport._mean1.data()), sizeof(double) * N);
+        stream.write(reinterpret_cast<const char*>(gaussianTransport._covariance0.data()), sizeof(double) * N * N);
+        stream.write(reinterpret_cast<const char*>(gaussianTransport._map.data()), sizeof(double) * N * N);
+        writeValue(stream, gaussianTransport._weight);
+        writeValue(stream, gaussianTransport._k);
+        writeValue(stream, gaussianTransport._l);
+    }
+}
+
+template <unsigned int N>
+bool SerializationUtils::readGmmTransport(std::ifstream& stream, ProbaUtils::GMMTransport<N>& transport)
+{
+    int size = 0;
+    if (!readValue(stream, size) || size < 0)
+        return false;
+
+    transport.resize(size);
+    for (auto& gaussianTransport : transport)
+    {
+        stream.read(reinterpret_cast<char*>(gaussianTransport._mean0.data()), sizeof(double) * N);
+        stream.read(reinterpret_cast<char*>(gaussianTransport._mean1.data()), sizeof(double) * N);
+        stream.read(reinterpret_cast<char*>(gaussianTransport._covariance0.data()), sizeof(double) * N * N);
+        stream.read(reinterpret_cast<char*>(gaussianTransport._map.data()), sizeof(double) * N * N);
+        if (!readValue(stream, gaussianTransport._weight) || !readValue(stream, gaussianTransport._k) || !readValue(stream, gaussianTransport._l))
+            return false;
+    }
+    return true;
+}
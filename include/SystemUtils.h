@@ -3,6 +3,8 @@
 #include "WindowsSafe.h"
 #include <string>
 #include <filesystem>
+#include <exception>
+#include <atomic>
 
 namespace SystemUtils
 {
@@ -12,4 +14,39 @@ namespace SystemUtils
         GetModuleFileName(NULL, buffer, sizeof(buffer));
         return std::filesystem::path(buffer).parent_path().string();
     }
+
+    class ParallelErrors //Exceptions can not leave an OpenMP parallel region, the first one is kept and rethrown after the loop
+    {
+    public:
+        template<typename Function>
+        void run(Function function)
+        {
+            //Remaining iterations are skipped once an iteration failed
+            if (_failed)
+                return;
+            try
+            {
+                function();
+            }
+            catch (...)
+            {
+                #pragma omp critical(ParallelErrors)
+                {
+                    if (!_error)
+                        _error = std::current_exception();
+                }
+                _failed = true;
+            }
+        }
+
+        void rethrow() const
+        {
+            if (_error)
+                std::rethrow_exception(_error);
+        }
+
+    private:
+        std::exception_ptr _error;
+        std::atomic<bool> _failed = false;
+    };
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Tiles.h"
+#include "DuplicateRemover.h"
+#include "FaceDetectionROI.h"
+#include "ModelCache.h"
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <atomic>
+
+
+class TileLibrary //Tiles folder scanned and deduplicated once, computed tiles are shared by mosaics with the same tile size
+{
+private:
+    static constexpr int MaxComputedSizes = 8;
+
+public:
+    TileLibrary(const std::string& path, int reduction);
+    ~TileLibrary();
+
+public:
+    void initialize(int minNbTiles);
+    std::shared_ptr<const Tiles> compute(const FaceDetectionROI& roi, const cv::Size& tileSize);
+    std::vector<std::shared_ptr<const Tiles>> compute(const FaceDetectionROI& roi, const std::vector<cv::Size>& tileSizes);
+    std::shared_ptr<const Tiles> compute(const FaceDetectionROI& roi, const cv::Size& tileSize, const std::vector<std::string>& imagePaths);
+    ModelCache& getModelCache();
+
+private:
+    std::string computeTempName() const;
+    using SizeKey = std::pair<int, int>;
+    using ComputedTiles = std::shared_future<std::shared_ptr<const Tiles>>;
+
+private:
+    void evict();
+
+private:
+    static std::atomic<int> _nbComputed; //Temporary folders stay unique while evicted tiles are still used
+    Tiles _tiles;
+    DuplicateRemover _duplicateRemover;
+    ModelCache _modelCache;
+    std::mutex _mutex;
+    bool _initialized;
+    std::map<SizeKey, ComputedTiles> _computed;
+    std::deque<SizeKey> _computedOrder;
+};
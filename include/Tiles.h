@@ -1,6 +1,5 @@
 #pragma once
 
-#include "Photo.h"
 #include "FaceDetectionROI.h"
 #include <vector>
 #include <string>
@@ -9,46 +8,54 @@
 
 class Tiles
 {
-private:
+public:
     static const std::string TempDir;
     static constexpr int FeatureDiv = 4;
     static constexpr int NbFeatures = 3 * FeatureDiv * FeatureDiv;
+
+private:
     static constexpr int TileParam[2] = {cv::IMWRITE_PNG_COMPRESSION, 0};
 
 public:
-    Tiles(const std::string& path, std::tuple<int, int> grid);
+    Tiles(const std::string& path, int reduction = 1, const std::string& tempName = TempDir);
+    Tiles(const Tiles& tiles, const std::string& tempName); //Same image list, computed in its own temporary folder
     ~Tiles();
 
 public:
     void initialize(int minNbTiles);
+    void initialize(const std::vector<std::string>& imagePaths);
     unsigned int getNbTiles() const;
     void readImage(int tileID, cv::Mat& image) const;
     void remove(std::vector<unsigned int>& toRemove);
-    void compute(const FaceDetectionROI& roi, const Photo& photo);
-    double computeDistance(int i, int j, int tileID) const;
+    void compute(const FaceDetectionROI& roi, const cv::Size& tileSize);
+    static void compute(const FaceDetectionROI& roi, const std::vector<Tiles*>& tiles, const std::vector<cv::Size>& tileSizes);
+    static void computeFeatures(const cv::Mat& image, double* features);
+    double computeDistance(const double* features, int tileID) const;
     const std::string getTileFilepath(int tileId) const;
+    void getTileReference(int tileId, std::string& imagePath, cv::Rect& box) const;
+    static void computeTile(cv::Mat& tile, const std::string& imagePath, const cv::Rect& box, const cv::Size& tileSize, int reduction);
 
 private:
     struct Data
     {
         std::string _imagePath = "";
         std::string _tilePath = "";
+        cv::Rect _box; //Crop of source image resampled to tile size
         double _features[NbFeatures] = { 0 };
     };
 
 private:
+    static int getReadFlags(int reduction);
     bool checkExtension(const std::string& extension) const;
     void createTemp() const;
     void removeTemp() const;
-    void computeTileFeatures(const cv::Mat& image, const FaceDetectionROI& roi, const cv::Size& tileSize, Data& data, int threadID);
-    void computeCropInfo(const cv::Mat& image, cv::Rect& box, const FaceDetectionROI& roi, const cv::Size& tileSize, int threadID);
+    void computeTileFeatures(const cv::Mat& image, const FaceDetectionROI& roi, const cv::Size& tileSize, Data& data, FaceDetectionROI::Detection& detection, int threadID);
+    void computeCropInfo(const cv::Mat& image, cv::Rect& box, const FaceDetectionROI& roi, const cv::Size& tileSize, FaceDetectionROI::Detection& detection, int threadID);
     void exportTile(const cv::Mat& tile, const std::string& tilePath);
 
 private:
     const std::string _path;
     const std::string _tempPath;
-    const int _gridWidth;
-    const int _gridHeight;
+    const int _reduction; //Images decoded at 1/2, 1/4 or 1/8 of their size in preview mode, crop boxes refer to decoded images
     std::vector<Data> _tilesData;
-    std::vector<double> _photoFeatures;
 };
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+
+
+template<int MaxSize>
+class TransportSolver //Transportation simplex for small dense balanced problems, workspaces are fixed size arrays
+{
+private:
+    static constexpr int MaxIter = 4 * MaxSize * MaxSize;
+    static constexpr double ReducedCostTol = 1e-12;
+
+public:
+    TransportSolver();
+    ~TransportSolver();
+
+public:
+    bool run(const double* supplies, int nbSupplies, const double* demands, int nbDemands, const double* costs); //Row-major costs, returns false if problem is too large or simplex does not converge.
+    double getCost() const;
+    double getFlow(int i, int j) const;
+
+private:
+    void initialize(const double* supplies, const double* demands);
+    void computePotentials();
+    int findPath(int row, int column);
+
+private:
+    int _nbSupplies;
+    int _nbDemands;
+    std::array<double, MaxSize * MaxSize> _costs;
+    std::array<double, MaxSize * MaxSize> _flows;
+    std::array<bool, MaxSize * MaxSize> _basis;
+    std::array<double, 2 * MaxSize> _potentials; //Supply nodes first, then demand nodes
+    std::array<int, 2 * MaxSize> _parents;
+    std::array<int, 2 * MaxSize> _nodes; //Search queue, then cycle path
+};
+
+
+template<int MaxSize>
+TransportSolver<MaxSize>::TransportSolver() :
+    _nbSupplies(0), _nbDemands(0)
+{
+}
+
+template<int MaxSize>
+TransportSolver<MaxSize>::~TransportSolver()
+{
+}
+
+template<int MaxSize>
+bool TransportSolver<MaxSize>::run(const double* supplies, int nbSupplies, const double* demands, int nbDemands, const double* costs)
+{
+    if (nbSupplies <= 0 || nbDemands <= 0 || nbSupplies > MaxSize || nbDemands > MaxSize)
+        return false;
+
+    _nbSupplies = nbSupplies;
+    _nbDemands = nbDemands;
+    double maxCost = 0;
+    for (int i = 0; i < _nbSupplies; i++)
+    {
+        for (int j = 0; j < _nbDemands; j++)
+        {
+            _costs[i * MaxSize + j] = costs[i * nbDemands + j];
+            maxCost = std::max(maxCost, std::abs(_costs[i * MaxSize + j]));
+        }
+    }
+
+    initialize(supplies, demands);
+
+    const double tolerance = ReducedCostTol * std::max(maxCost, 1.);
+    for (int iter = 0; iter < MaxIter; iter++)
+    {
+        computePotentials();
+
+        //Dantzig rule, most negative reduced cost enters the basis
+        int enteringRow = -1, enteringColumn = -1;
+        double minReducedCost = -tolerance;
+        for (int i = 0; i < _nbSupplies; i++)
+        {
+            for (int j = 0; j < _nbDemands; j++)
+            {
+                const double reducedCost = _costs[i * MaxSize + j] - _potentials[i] - _potentials[_nbSupplies + j];
+                if (!_basis[i * MaxSize + j] && reducedCost < minReducedCost)
+                {
+                    minReducedCost = reducedCost;
+                    enteringRow = i;
+                    enteringColumn = j;
+                }
+            }
+        }
+
+        if (enteringRow < 0)
+            return true;
+
+        //Path edges alternately lose and gain flow, first edge leaves the entering row
+        const int pathLength = findPath(enteringRow, enteringColumn);
+        double theta = -1;
+        int leavingCell = -1;
+        for (int e = 0; e < pathLength; e += 2)
+        {
+            const int row = std::min(_nodes[e], _nodes[e + 1]);
+            const int cell = row * MaxSize + std::max(_nodes[e], _nodes[e + 1]) - _nbSupplies;
+            if (leavingCell < 0 || _flows[cell] < theta)
+            {
+                theta = _flows[cell];
+                leavingCell = cell;
+            }
+        }
+
+        for (int e = 0; e < pathLength; e++)
+        {
+            const int row = std::min(_nodes[e], _nodes[e + 1]);
+            const int cell = row * MaxSize + std::max(_nodes[e], _nodes[e + 1]) - _nbSupplies;
+            _flows[cell] += (e % 2) ? theta : -theta;
+        }
+
+        const int enteringCell = enteringRow * MaxSize + enteringColumn;
+        _flows[enteringCell] = theta;
+        _basis[enteringCell] = true;
+        _flows[leavingCell] = 0;
+        _basis[leavingCell] = false;
+    }
+
+    return false;
+}
+
+template<int MaxSize>
+double TransportSolver<MaxSize>::getCost() const
+{
+    double cost = 0;
+    for (int i = 0; i < _nbSupplies; i++)
+        for (int j = 0; j < _nbDemands; j++)
+            cost += _flows[i * MaxSize + j] * _costs[i * MaxSize + j];
+
+    return cost;
+}
+
+template<int MaxSize>
+double TransportSolver<MaxSize>::getFlow(int i, int j) const
+{
+    return _flows[i * MaxSize + j];
+}
+
+template<int MaxSize>
+void TransportSolver<MaxSize>::initialize(const double* supplies, const double* demands)
+{
+    //Least cost rule, each allocation closes one row or column so that basis is a spanning tree of nbSupplies + nbDemands - 1 cells
+    std::array<double, MaxSize> remainingSupplies;
+    std::array<double, MaxSize> remainingDemands;
+    std::array<bool, MaxSize> rowsDone;
+    std::array<bool, MaxSize> columnsDone;
+    std::copy(supplies, supplies + _nbSupplies, remainingSupplies.begin());
+    std::copy(demands, demands + _nbDemands, remainingDemands.begin());
+    rowsDone.fill(false);
+    columnsDone.fill(false);
+    _flows.fill(0);
+    _basis.fill(false);
+
+    const int nbCells = _nbSupplies * _nbDemands;
+    std::array<int, MaxSize * MaxSize> cells;
+    for (int c = 0; c < nbCells; c++)
+        cells[c] = (c / _nbDemands) * MaxSize + c % _nbDemands;
+    std::sort(cells.begin(), cells.begin() + nbCells, [this](int cell0, int cell1) { return _costs[cell0] < _costs[cell1]; });
+
+    int nbRows = _nbSupplies, nbColumns = _nbDemands;
+    for (int c = 0; nbRows > 0 && nbColumns > 0; c++)
+    {
+        const int row = cells[c] / MaxSize;
+        const int column = cells[c] % MaxSize;
+        if (rowsDone[row] || columnsDone[column])
+            continue;
+
+        const double flow = std::max(std::min(remainingSupplies[row], remainingDemands[column]), 0.);
+        _flows[row * MaxSize + column] = flow;
+        _basis[row * MaxSize + column] = true;
+        remainingSupplies[row] -= flow;
+        remainingDemands[column] -= flow;
+
+        if (nbColumns == 1 || (nbRows > 1 && remainingSupplies[row] <= remainingDemands[column]))
+        {
+            rowsDone[row] = true;
+            nbRows--;
+        }
+        else
+        {
+            columnsDone[column] = true;
+            nbColumns--;
+        }
+    }
+}
+
+template<int MaxSize>
+void TransportSolver<MaxSize>::computePotentials()
+{
+    //Reduced costs of basic cells are null, potentials are propagated along the basis tree
+    const int nbNodes = _nbSupplies + _nbDemands;
+    std::fill(_parents.begin(), _parents.begin() + nbNodes, -1);
+    _potentials[0] = 0;
+    _parents[0] = 0;
+    _nodes[0] = 0;
+
+    for (int front = 0, back = 1; front < back; front++)
+    {
+        const int node = _nodes[front];
+        if (node < _nbSupplies)
+        {
+            for (int j = 0; j < _nbDemands; j++)
+            {
+                const int next = _nbSupplies + j;
+                if (_basis[node * MaxSize + j] && _parents[next] < 0)
+                {
+                    _potentials[next] = _costs[node * MaxSize + j] - _potentials[node];
+                    _parents[next] = node;
+                    _nodes[back++] = next;
+                }
+            }
+        }
+        else
+        {
+            const int j = node - _nbSupplies;
+            for (int i = 0; i < _nbSupplies; i++)
+            {
+                if (_basis[i * MaxSize + j] && _parents[i] < 0)
+                {
+                    _potentials[i] = _costs[i * MaxSize + j] - _potentials[node];
+                    _parents[i] = node;
+                    _nodes[back++] = i;
+                }
+            }
+        }
+    }
+}
+
+template<int MaxSize>
+int TransportSolver<MaxSize>::findPath(int row, int column)
+{
+    //Basis tree is searched from entering row, path is stored from row to column nodes
+    const int nbNodes = _nbSupplies + _nbDemands;
+    const int target = _nbSupplies + column;
+    std::fill(_parents.begin(), _parents.begin() + nbNodes, -1);
+    _parents[row] = row;
+    _nodes[0] = row;
+
+    for (int front = 0, back = 1; front < back && _parents[target] < 0; front++)
+    {
+        const int node = _nodes[front];
+        if (node < _nbSupplies)
+        {
+            for (int j = 0; j < _nbDemands; j++)
+            {
+                const int next = _nbSupplies + j;
+                if (_basis[node * MaxSize + j] && _parents[next] < 0)
+                {
+                    _parents[next] = node;
+                    _nodes[back++] = next;
+                }
+            }
+        }
+        else
+        {
+            const int j = node - _nbSupplies;
+            for (int i = 0; i < _nbSupplies; i++)
+            {
+                if (_basis[i * MaxSize + j] && _parents[i] < 0)
+                {
+                    _parents[i] = node;
+                    _nodes[back++] = i;
+                }
+            }
+        }
+    }
+
+    int pathLength = 0;
+    for (int node = target; node != row; node = _parents[node])
+        pathLength++;
+    for (int node = target, n = pathLength; n >= 0; node = _parents[node], n--)
+        _nodes[n] = node;
+
+    return pathLength;
+}
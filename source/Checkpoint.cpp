@@ -0,0 +1,150 @@
+#include "Checkpoint.h"
+#include "SerializationUtils.h"
+#include "CustomException.h"
+#include "Log.h"
+#include <fstream>
+
+
+Checkpoint::Checkpoint(const std::string& photoPath, std::tuple<int, int> grid, double scale, std::tuple<int, int, bool> resolution, ColorTransfer::Engine colorEngine, bool preview, int tileReduction) :
+    _photoPath(photoPath), _grid(grid), _scale(scale), _resolution(resolution), _colorEngine(colorEngine), _preview(preview), _tileReduction(tileReduction)
+{
+}
+
+Checkpoint::Checkpoint(const std::string& path) :
+    _scale(0), _colorEngine(ColorTransfer::GMM_OT), _preview(false), _tileReduction(1)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.is_open())
+        throw CustomException("Impossible to open checkpoint : " + path, CustomException::Level::ERROR);
+
+    unsigned int magic = 0, version = 0;
+    if (!SerializationUtils::readValue(stream, magic) || !SerializationUtils::readValue(stream, version) || magic != FileMagic || version != FileVersion)
+        throw CustomException("Invalid checkpoint file : " + path, CustomException::Level::ERROR);
+
+    int gridWidth = 0, gridHeight = 0, resolutionWidth = 0, resolutionHeight = 0, colorEngine = 0, nbTiles = 0;
+    bool resolutionCrop = false;
+    bool valid = SerializationUtils::readString(stream, _photoPath) && SerializationUtils::readValue(stream, gridWidth) && SerializationUtils::readValue(stream, gridHeight);
+    valid = valid && SerializationUtils::readValue(stream, _scale) && SerializationUtils::readValue(stream, resolutionWidth) && SerializationUtils::readValue(stream, resolutionHeight) && SerializationUtils::readValue(stream, resolutionCrop);
+    valid = valid && SerializationUtils::readValue(stream, colorEngine) && SerializationUtils::readValue(stream, _preview) && SerializationUtils::readValue(stream, _tileReduction);
+    valid = valid && SerializationUtils::readValue(stream, nbTiles) && gridWidth > 0 && gridHeight > 0 && nbTiles >= 0 && ColorTransfer::GMM_OT <= colorEngine && colorEngine <= ColorTransfer::HISTOGRAM && _tileReduction > 0;
+    _grid = std::make_tuple(gridWidth, gridHeight);
+    _resolution = std::make_tuple(resolutionWidth, resolutionHeight, resolutionCrop);
+    _colorEngine = (ColorTransfer::Engine)colorEngine;
+
+    if (valid)
+    {
+        _tiles.resize(nbTiles);
+        for (auto& tile : _tiles)
+        {
+            valid = valid && SerializationUtils::readString(stream, tile._imagePath);
+            valid = valid && SerializationUtils::readValue(stream, tile._box.x) && SerializationUtils::readValue(stream, tile._box.y) && SerializationUtils::readValue(stream, tile._box.width) && SerializationUtils::readValue(stream, tile._box.height);
+            valid = valid && SerializationUtils::readGmm<3>(stream, tile._gmm);
+        }
+    }
+
+    if (valid)
+    {
+        _cells.resize(gridWidth * gridHeight);
+        for (auto& cell : _cells)
+        {
+            valid = valid && SerializationUtils::readValue(stream, cell._tile) && 0 <= cell._tile && cell._tile < nbTiles;
+            valid = valid && SerializationUtils::readGmmTransport<3>(stream, cell._model._transport) && SerializationUtils::readValue(stream, cell._model._blendingScale);
+        }
+    }
+
+    if (!valid)
+        throw CustomException("Corrupted checkpoint file : " + path, CustomException::Level::ERROR);
+
+    Log::Logger::get().log(Log::TRACE) << "Checkpoint loaded from " << path << " : " << _tiles.size() << " tiles, " << _cells.size() << " cells.";
+}
+
+Checkpoint::~Checkpoint()
+{
+}
+
+void Checkpoint::save(const std::string& path) const
+{
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream.is_open())
+        throw CustomException("Impossible to create checkpoint : " + path, CustomException::Level::ERROR);
+
+    SerializationUtils::writeValue(stream, FileMagic);
+    SerializationUtils::writeValue(stream, FileVersion);
+    SerializationUtils::writeString(stream, _photoPath);
+    SerializationUtils::writeValue(stream, std::get<0>(_grid));
+    SerializationUtils::writeValue(stream, std::get<1>(_grid));
+    SerializationUtils::writeValue(stream, _scale);
+    SerializationUtils::writeValue(stream, std::get<0>(_resolution));
+    SerializationUtils::writeValue(stream, std::get<1>(_resolution));
+    SerializationUtils::writeValue(stream, std::get<2>(_resolution));
+    SerializationUtils::writeValue(stream, (int)_colorEngine);
+    SerializationUtils::writeValue(stream, _preview);
+    SerializationUtils::writeValue(stream, _tileReduction);
+
+    SerializationUtils::writeValue(stream, (int)_tiles.size());
+    for (const auto& tile : _tiles)
+    {
+        SerializationUtils::writeString(stream, tile._imagePath);
+        SerializationUtils::writeValue(stream, tile._box.x);
+        SerializationUtils::writeValue(stream, tile._box.y);
+        SerializationUtils::writeValue(stream, tile._box.width);
+        SerializationUtils::writeValue(stream, tile._box.height);
+        SerializationUtils::writeGmm<3>(stream, tile._gmm);
+    }
+
+    for (const auto& cell : _cells)
+    {
+        SerializationUtils::writeValue(stream, cell._tile);
+        SerializationUtils::writeGmmTransport<3>(stream, cell._model._transport);
+        SerializationUtils::writeValue(stream, cell._model._blendingScale);
+    }
+
+    if (!stream.good())
+        throw CustomException("Impossible to write checkpoint : " + path, CustomException::Level::ERROR);
+    Log::Logger::get().log(Log::INFO) << "Checkpoint saved at " << path;
+}
+
+const std::string& Checkpoint::getPhotoPath() const
+{
+    return _photoPath;
+}
+
+std::tuple<int, int> Checkpoint::getGrid() const
+{
+    return _grid;
+}
+
+double Checkpoint::getScale() const
+{
+    return _scale;
+}
+
+std::tuple<int, int, bool> Checkpoint::getResolution() const
+{
+    return _resolution;
+}
+
+ColorTransfer::Engine Checkpoint::getColorEngine() const
+{
+    return _colorEngine;
+}
+
+bool Checkpoint::getPreview() const
+{
+    return _preview;
+}
+
+int Checkpoint::getTileReduction() const
+{
+    return _tileReduction;
+}
+
+std::vector<Checkpoint::TileReference>& Checkpoint::getTiles()
+{
+    return _tiles;
+}
+
+std::vector<Checkpoint::Cell>& Checkpoint::getCells()
+{
+    return _cells;
+}
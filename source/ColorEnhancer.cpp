@@ -5,22 +5,69 @@
 #include "ImageUtils.h"
 #include "ColorUtils.h"
 #include <numbers>
+#include <numeric>
 
 
-ColorEnhancer::ColorEnhancer(const ProbaUtils::Histogram<3>& sourceHistogram, const ProbaUtils::GMMNDComponents<3>& sourceGmm, const ProbaUtils::GMMNDComponents<3>& targetGmm, const ProbaUtils::GMMSamplerDatas<3>& datas) :
-    _sourceHistogram(sourceHistogram), _sourceGmm(sourceGmm), _targetGmm(targetGmm), _datas(datas), _blendingScale(1.)
+ColorEnhancer::Source::Source(const ProbaUtils::Histogram<3>& histogram, const ProbaUtils::GMMNDComponents<3>& gmm, const ProbaUtils::GMMSamplerDatas<3>& datas, const cv::Size& size) :
+    _histogram(histogram), _gmm(gmm), _useLut(false), _coverage(0),
+    _guidedFilter(computeGuide(histogram), size, FilterRadius, FilterEpsilon, computeFilterSubsampling(size))
 {
-    const int nbValues = _sourceHistogram._values.size();
-    _histCompProbas.resize(_sourceGmm.size() * nbValues);
-    std::vector<double> histProbaNorms(nbValues);
-    ProbaUtils::evalGaussianPDF(_histCompProbas, histProbaNorms, _sourceHistogram._values, sourceGmm, true);
+    //Transfer is evaluated on a fixed lattice when tile has more unique colors than lattice nodes
+    const std::vector<MathUtils::VectorNd<3>>& lattice = getLutLattice();
+    _useLut = _histogram._values.size() > lattice.size();
+
+    //Lattice nodes far from every tile component keep normalized posteriors, they would be mapped to black otherwise
+    if (_useLut)
+    {
+        ProbaUtils::evalGaussianPosteriors(_lutCompProbas, lattice, _gmm);
+
+        //Flat regions are fitted by narrow components the lattice can not resolve and gamut borders are interpolated from nodes out of tile gamut,
+        //their colors are transferred exactly
+        const int minCount = (int)std::ceil(LutExactMinShare * _histogram._nbData);
+        for (int h = 0; h < _histogram._values.size(); h++)
+        {
+            const MathUtils::VectorNd<3>& value = _histogram._values[h];
+            if (_histogram._counts[h] >= minCount || value.minCoeff() <= 0 || value.maxCoeff() >= 255)
+            {
+                _lutExactIds.push_back(h);
+                _lutExactValues.push_back(value);
+            }
+        }
+        ProbaUtils::evalGaussianPosteriors(_lutExactCompProbas, _lutExactValues, _gmm);
+    }
+    else
+        ProbaUtils::evalGaussianPosteriors(_histCompProbas, _histogram._values, _gmm);
+
+    _coverage = computeGMMSamplingCoverage(_gmm, datas, CoverageGridDivisions, CoverageConfidence);
+}
+
+ColorEnhancer::Source::~Source()
+{
+}
+
+ColorTransfer::CostProfile ColorEnhancer::getCostProfile()
+{
+    return {"gmm", true, "Gaussian mixture fit, sampling coverage", "Gaussian mixture fit, W2 transport, coverage search, guided filter"};
+}
+
+ColorEnhancer::ColorEnhancer(const Source& source, const ProbaUtils::GMMNDComponents<3>& targetGmm, const ProbaUtils::GMMSamplerDatas<3>& datas, const Model* model) :
+    _source(source), _sourceHistogram(source._histogram), _sourceGmm(source._gmm), _targetGmm(targetGmm), _datas(datas), _blendingScale(1.)
+{
+    //Stored transport and blending scale skip W2 computation and coverage search
+    if (model)
+    {
+        _transport = model->_transport;
+        _blendingScale = model->_blendingScale;
+        return;
+    }
 
-    double distance = ProbaUtils::computeGmmW2<3>(_wstar, _sourceGmm, _targetGmm);
+    ProbaUtils::W2Minimizers wstar;
+    double distance = ProbaUtils::computeGmmW2<3>(wstar, _sourceGmm, _targetGmm);
+    ProbaUtils::computeGmmTransport<3>(_transport, _sourceGmm, _targetGmm, wstar);
 
-    double sourceCoverage = computeGMMSamplingCoverage(sourceGmm, CoverageGridDivisions, CoverageConfidence);
-    double targetCoverage = computeGMMSamplingCoverage(targetGmm, CoverageGridDivisions, CoverageConfidence);
+    double targetCoverage = computeGMMSamplingCoverage(targetGmm, _datas, CoverageGridDivisions, CoverageConfidence);
     
-    double minCoverage = CoverageMinRatio * sourceCoverage;
+    double minCoverage = CoverageMinRatio * _source._coverage;
     if (targetCoverage < minCoverage)
         _blendingScale = goldenSectionSearch(minCoverage);
 }
@@ -29,6 +76,11 @@ ColorEnhancer::~ColorEnhancer()
 {
 }
 
+ColorTransfer::Model ColorEnhancer::getModel() const
+{
+    return {_transport, _blendingScale};
+}
+
 void ColorEnhancer::apply(cv::Mat& enhancedImage, double blending)
 {
     std::vector<MathUtils::VectorNd<3>> colorMap(_sourceHistogram._values.size(), MathUtils::VectorNd<3>::Zero());
@@ -36,25 +88,50 @@ void ColorEnhancer::apply(cv::Mat& enhancedImage, double blending)
 
     //Compute color enhanced color image
     const int nbPixels = enhancedImage.rows * enhancedImage.cols;
-    std::vector<double> img(nbPixels * 3);
     std::vector<double> enhancedDiff(nbPixels * 3);
     for (int p = 0, k = 0; p < nbPixels; p++)
     {
         int mapId = _sourceHistogram._mapId[p];
         const MathUtils::VectorNd<3>& pixel = _sourceHistogram._values[mapId];
         for (int c = 0; c < 3; c++, k++)
-        {
-            img[k] = pixel(c);
-            enhancedDiff[k] = colorMap[mapId](c) - img[k];
-        }
+            enhancedDiff[k] = colorMap[mapId](c) - pixel(c);
     }
 
-    //Compute correction to avoid artifacts on enhanced image
+    //Compute correction to avoid artifacts on enhanced image, guide statistics are shared by all cells and blending steps
     std::vector<double> filtered(nbPixels * 3);
-    ImageUtils::guidedFiltering(filtered, enhancedDiff, img, enhancedImage.size(), FilterRadius, FilterEpsilon);
+    _source._guidedFilter.apply(filtered, enhancedDiff, _filterBuffers);
+
+    for (int p = 0, k = 0; p < nbPixels; p++)
+    {
+        const MathUtils::VectorNd<3>& pixel = _sourceHistogram._values[_sourceHistogram._mapId[p]];
+        for (int c = 0; c < 3; c++, k++)
+            enhancedImage.data[k] = ColorUtils::clip<double>(pixel(c) + filtered[k], 0, 255);
+    }
+}
+
+std::vector<double> ColorEnhancer::computeGuide(const ProbaUtils::Histogram<3>& histogram)
+{
+    const int nbPixels = histogram._mapId.size();
+    std::vector<double> guide(nbPixels * 3);
+    for (int p = 0, k = 0; p < nbPixels; p++)
+    {
+        const MathUtils::VectorNd<3>& pixel = histogram._values[histogram._mapId[p]];
+        for (int c = 0; c < 3; c++, k++)
+            guide[k] = pixel(c);
+    }
 
-    for (int k = 0; k < nbPixels * 3; k++)
-        enhancedImage.data[k] = ColorUtils::clip<double>(img[k] + filtered[k], 0, 255);
+    return guide;
+}
+
+int ColorEnhancer::computeFilterSubsampling(const cv::Size& size)
+{
+    //Fast guided filter is used on large tiles, where subsampling artifacts are not visible
+    const int minSize = std::min(size.width, size.height);
+    if (minSize >= FilterSubsampling4MinSize)
+        return 4;
+    if (minSize >= FilterSubsampling2MinSize)
+        return 2;
+    return 1;
 }
 
 double ColorEnhancer::goldenSectionSearch(double coverage)
@@ -102,10 +179,13 @@ double ColorEnhancer::goldenSectionSearch(double coverage)
     return (tmin + tmax) * 0.5;
 }
 
-double ColorEnhancer::computeGMMSamplingCoverage(const ProbaUtils::GMMNDComponents<3>& gmm, int nbDivisions, double confidence)
+//Measured by the test project bench on 8 synthetic 128x128 tiles and the 7 W2 midpoints between consecutive tiles,
+//against 1e6 pseudo-random samples (seed noise 0.2% mean, 0.4% max) :
+//Sobol 2^18 samples, the MosaicBuilder count, differs by 2.2% mean and 7.7% max, pseudo-random 2^18 samples by 4.1% mean and 11.8% max
+double ColorEnhancer::computeGMMSamplingCoverage(const ProbaUtils::GMMNDComponents<3>& gmm, const ProbaUtils::GMMSamplerDatas<3>& datas, int nbDivisions, double confidence)
 {
     ProbaUtils::GMMSamples<3> samples;
-    ProbaUtils::computeGmmSamples(samples, gmm, _datas);
+    ProbaUtils::computeGmmSamples(samples, gmm, datas);
 
     const int nbSamples = samples.size();
     int nbValidSamples = 0;
@@ -136,61 +216,142 @@ double ColorEnhancer::computeGMMSamplingCoverage(const ProbaUtils::GMMNDComponen
             nbValidSamples++;
         }
     }
-    std::sort(histogram.begin(), histogram.end(), std::greater<int>());
+    if (nbValidSamples == 0)
+        return 0;
 
-    double coverage = 0;
+    //Partial selection of the most populated bins reaching the confidence limit, empty bins are discarded first
+    auto first = histogram.begin();
+    auto last = std::remove(histogram.begin(), histogram.end(), 0);
     int cumulatedNbSamples = 0;
     double confidenceLimit = confidence * nbValidSamples;
-    for (int b = 0; b < nbBins; b++)
+    while (last - first > 1)
     {
-        cumulatedNbSamples += histogram[b];
-        if (cumulatedNbSamples >= confidenceLimit)
+        auto middle = first + (last - first) / 2;
+        std::nth_element(first, middle, last, std::greater<int>());
+        const int upperNbSamples = std::accumulate(first, middle, 0);
+        if (cumulatedNbSamples + upperNbSamples >= confidenceLimit)
+        {
+            last = middle;
+        }
+        else
         {
-            double binRatio = (histogram[b] - cumulatedNbSamples + confidenceLimit) / histogram[b];
-            coverage = (b + binRatio) / nbBins;
-            break;
+            cumulatedNbSamples += upperNbSamples;
+            first = middle;
         }
     }
 
-    return coverage;
+    const int b = first - histogram.begin();
+    cumulatedNbSamples += histogram[b];
+    double binRatio = (histogram[b] - cumulatedNbSamples + confidenceLimit) / histogram[b];
+    return (b + binRatio) / nbBins;
 }
 
 double ColorEnhancer::computeCoverageDist(double t, double coverage)
 {
     ProbaUtils::GMMNDComponents<3> gmmt;
-    ProbaUtils::computeGmmInterpolation(gmmt, t, _sourceGmm, _targetGmm, _wstar);
-    double coveraget = computeGMMSamplingCoverage(gmmt, CoverageGridDivisions, CoverageConfidence);
+    ProbaUtils::computeGmmInterpolation<3>(gmmt, t, _transport);
+    double coveraget = computeGMMSamplingCoverage(gmmt, _datas, CoverageGridDivisions, CoverageConfidence);
 
     return abs(coverage - coveraget);
 }
 
 void ColorEnhancer::computeColorMap(std::vector<MathUtils::VectorNd<3>>& colorMap, double t) const
+{
+    if (_source._useLut)
+    {
+        const std::vector<MathUtils::VectorNd<3>>& lattice = getLutLattice();
+        std::vector<MathUtils::VectorNd<3>> lut(lattice.size(), MathUtils::VectorNd<3>::Zero());
+        computeTransfer(lut, lattice, _source._lutCompProbas, t);
+        interpolateLut(colorMap, lut);
+
+        std::vector<MathUtils::VectorNd<3>> exactMap(_source._lutExactValues.size(), MathUtils::VectorNd<3>::Zero());
+        computeTransfer(exactMap, _source._lutExactValues, _source._lutExactCompProbas, t);
+        for (int e = 0; e < exactMap.size(); e++)
+            colorMap[_source._lutExactIds[e]] = exactMap[e];
+    }
+    else
+    {
+        computeTransfer(colorMap, _sourceHistogram._values, _source._histCompProbas, t);
+    }
+}
+
+void ColorEnhancer::computeTransfer(std::vector<MathUtils::VectorNd<3>>& colorMap, const std::vector<MathUtils::VectorNd<3>>& values, const std::vector<double>& compProbas, double t) const
 {
     const int nbComponents = _sourceGmm.size();
-    const int nbValues = _sourceHistogram._values.size();
-    const int wstarSize = _wstar.size();
+    const int nbValues = values.size();
+    const int wstarSize = _transport.size();
 
     ProbaUtils::GMMNDComponents<3> gmmt;
-    ProbaUtils::computeGmmInterpolation<3>(gmmt, t, _sourceGmm, _targetGmm, _wstar);
+    ProbaUtils::computeGmmInterpolation<3>(gmmt, t, _transport);
 
+    //Optimal map between source and interpolated components is the interpolated Bures map
     std::vector<MathUtils::MatrixNd<3>> transferMap(wstarSize);
     for (int w = 0; w < wstarSize; w++)
-    {
-        double k = _wstar[w]._k;
-        const MathUtils::MatrixNd<3>& sigma0 = _sourceGmm[k]._covariance;
-        const MathUtils::MatrixNd<3>& sigmaT = gmmt[w]._covariance;
-        transferMap[w] = (MathUtils::inv<3>(sigma0) * MathUtils::sqrt<3>(sigma0 * sigmaT)).transpose();
-    }
+        transferMap[w] = (1 - t) * MathUtils::MatrixNd<3>::Identity() + t * _transport[w]._map;
 
     for (int h = 0; h < nbValues; h++)
     {
         for (int w = 0; w < wstarSize; w++)
         {
-            double k = _wstar[w]._k;
-            colorMap[h] += gmmt[w]._weight / _sourceGmm[k]._weight * _histCompProbas[h * nbComponents + k] * (gmmt[w]._mean + transferMap[w] * (_sourceHistogram._values[h] - _sourceGmm[k]._mean));
+            const unsigned int k = _transport[w]._k;
+            colorMap[h] += gmmt[w]._weight / _sourceGmm[k]._weight * compProbas[h * nbComponents + k] * (gmmt[w]._mean + transferMap[w] * (values[h] - _sourceGmm[k]._mean));
         }
 
         colorMap[h] = colorMap[h].cwiseMax(0).cwiseMin(255); //clipping
     }
 }
 
+void ColorEnhancer::interpolateLut(std::vector<MathUtils::VectorNd<3>>& colorMap, const std::vector<MathUtils::VectorNd<3>>& lut) const
+{
+    //Trilinear interpolation of lattice transfer for each tile color
+    const double invStep = (LutSize - 1) / 255.;
+    const int strides[3] = {1, LutSize, LutSize * LutSize};
+    const int nbValues = _sourceHistogram._values.size();
+
+    for (int h = 0; h < nbValues; h++)
+    {
+        const MathUtils::VectorNd<3>& value = _sourceHistogram._values[h];
+        int base = 0;
+        int offsets[3];
+        double weights[3];
+        for (int c = 0; c < 3; c++)
+        {
+            const double position = ColorUtils::clip<double>(value(c), 0, 255) * invStep;
+            const int node = std::min((int)position, LutSize - 2);
+            weights[c] = position - node;
+            offsets[c] = strides[c];
+            base += node * strides[c];
+        }
+
+        colorMap[h].setZero();
+        for (int corner = 0; corner < 8; corner++)
+        {
+            int index = base;
+            double weight = 1.;
+            for (int c = 0; c < 3; c++)
+            {
+                const bool upper = (corner >> c) & 1;
+                index += upper ? offsets[c] : 0;
+                weight *= upper ? weights[c] : 1. - weights[c];
+            }
+            colorMap[h] += weight * lut[index];
+        }
+    }
+}
+
+const std::vector<MathUtils::VectorNd<3>>& ColorEnhancer::getLutLattice()
+{
+    static const std::vector<MathUtils::VectorNd<3>> lattice = []()
+        {
+            const double step = 255. / (LutSize - 1);
+            std::vector<MathUtils::VectorNd<3>> nodes(LutSize * LutSize * LutSize);
+            for (int i = 0, n = 0; i < LutSize; i++)
+                for (int j = 0; j < LutSize; j++)
+                    for (int k = 0; k < LutSize; k++, n++)
+                        nodes[n] = MathUtils::VectorNd<3>(k * step, j * step, i * step);
+            return nodes;
+        }();
+
+    return lattice;
+}
+
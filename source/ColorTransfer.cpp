@@ -0,0 +1,64 @@
+#include "ColorTransfer.h"
+#include "ColorEnhancer.h"
+#include "ReinhardTransfer.h"
+#include "HistogramTransfer.h"
+#include "CustomException.h"
+
+
+bool ColorTransfer::findEngine(const std::string& name, Engine& engine)
+{
+    for (Engine candidate : Engines)
+    {
+        if (getCostProfile(candidate)._name == name)
+        {
+            engine = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+ColorTransfer::CostProfile ColorTransfer::getCostProfile(Engine engine)
+{
+    switch (engine)
+    {
+    case GMM_OT:
+        return ColorEnhancer::getCostProfile();
+    case REINHARD:
+        return ReinhardTransfer::getCostProfile();
+    case HISTOGRAM:
+        return HistogramTransfer::getCostProfile();
+    default:
+        throw CustomException("Unknown color transfer engine.", CustomException::Level::ERROR);
+    }
+}
+
+std::shared_ptr<const ColorTransfer::Source> ColorTransfer::createSource(Engine engine, const ProbaUtils::Histogram<3>& histogram, const ProbaUtils::GMMNDComponents<3>& gmm, const ProbaUtils::GMMSamplerDatas<3>& datas, const cv::Size& size)
+{
+    switch (engine)
+    {
+    case GMM_OT:
+        return std::make_shared<const ColorEnhancer::Source>(histogram, gmm, datas, size);
+    case REINHARD:
+        return std::make_shared<const ReinhardTransfer::Source>(histogram);
+    case HISTOGRAM:
+        return std::make_shared<const HistogramTransfer::Source>(histogram);
+    default:
+        throw CustomException("Unknown color transfer engine.", CustomException::Level::ERROR);
+    }
+}
+
+std::unique_ptr<ColorTransfer> ColorTransfer::create(Engine engine, const Source& source, const cv::Mat& cell, const ProbaUtils::GMMNDComponents<3>& cellGmm, const ProbaUtils::GMMSamplerDatas<3>& datas, const Model* model)
+{
+    switch (engine)
+    {
+    case GMM_OT:
+        return std::make_unique<ColorEnhancer>(static_cast<const ColorEnhancer::Source&>(source), cellGmm, datas, model);
+    case REINHARD:
+        return std::make_unique<ReinhardTransfer>(static_cast<const ReinhardTransfer::Source&>(source), cell);
+    case HISTOGRAM:
+        return std::make_unique<HistogramTransfer>(static_cast<const HistogramTransfer::Source&>(source), cell);
+    default:
+        throw CustomException("Unknown color transfer engine.", CustomException::Level::ERROR);
+    }
+}
@@ -366,9 +366,9 @@ void ColorUtils::BGRtoLAB(double& L, double& a, double& b, uchar blue, uchar gre
     double G = (double)green / 255.;
     double B = (double)blue / 255.;
 
-    double X_norm = (0.49 * R + 0.31 * G + 0.2 * B) / 16.820804;
-    double Y_norm = (0.17697 * R + 0.8124 * G + 0.01063 * B) / 17.697;
-    double Z_norm = (0.01 * G + 0.99 * B) / 19.269201;
+    double X_norm = (0.49 * R + 0.31 * G + 0.2 * B) / 0.950489;
+    double Y_norm = 0.17697 * R + 0.8124 * G + 0.01063 * B;
+    double Z_norm = (0.01 * G + 0.99 * B) / 1.08884;
 
     double X_var, Y_var, Z_var;
 
@@ -391,9 +391,7 @@ void ColorUtils::BGRtoLAB(double& L, double& a, double& b, uchar blue, uchar gre
     a = 500 * (X_var - Y_var);
     b = 200 * (Y_var - Z_var);
 
-    L = clip<double>(L, 0., 100.);
-    a = clip<double>(a, -100., 100.);
-    b = clip<double>(b, -100., 100.);
+    L = clip<double>(L, 0., 100.); //a and b are not clipped to keep saturated colors invertible
 }
 
 void ColorUtils::LABtoBGR(uchar& blue, uchar& green, uchar& red, double L, double a, double b)
@@ -415,23 +413,24 @@ void ColorUtils::LABtoBGR(uchar& blue, uchar& green, uchar& red, double L, doubl
     double X, Y, Z;
 
     if (X_var > 0.206896)
-        X = 95.0489 * X_var * X_var * X_var;
+        X = 0.950489 * X_var * X_var * X_var;
     else
-        X = 12.206042 * X_var - 1.683594;
+        X = 0.12206042 * X_var - 0.01683594;
 
     if (Y_var > 0.206896)
-        Y = 100. * Y_var * Y_var * Y_var;
+        Y = Y_var * Y_var * Y_var;
     else
-        Y = 12.841855 * Y_var - 1.771290;
+        Y = 0.12841855 * Y_var - 0.01771290;
 
     if (Z_var > 0.206896)
-        Z = 108.884 * Z_var * Z_var * Z_var;
+        Z = 1.08884 * Z_var * Z_var * Z_var;
     else
-        Z = 13.982725 * Z_var - 1.928652;
+        Z = 0.13982725 * Z_var - 0.01928652;
 
-    red = (uchar)clip<int>((int)round((0.41847 * X - 0.15866 * Y - 0.082835 * Z) * 255.), 0, 255);
-    green = (uchar)clip<int>((int)round((-0.091169 * X + 0.25243 * Y + 0.015708 * Z) * 255.), 0, 255);
-    blue = (uchar)clip<int>((int)round((0.0009209 * X - 0.0025498 * Y + 0.1786 * Z) * 255.), 0, 255);
+    //XYZ is normalized with white luminance 1, inverse matrix coefficients are scaled accordingly
+    red = (uchar)clip<int>((int)round((0.41847 * X - 0.15866 * Y - 0.082835 * Z) * 255. / 0.17697), 0, 255);
+    green = (uchar)clip<int>((int)round((-0.091169 * X + 0.25243 * Y + 0.015708 * Z) * 255. / 0.17697), 0, 255);
+    blue = (uchar)clip<int>((int)round((0.0009209 * X - 0.0025498 * Y + 0.1786 * Z) * 255. / 0.17697), 0, 255);
 }
 
 
@@ -0,0 +1,156 @@
+#include "DeepZoomWriter.h"
+#include "CustomException.h"
+#include "SystemUtils.h"
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+
+
+DeepZoomWriter::DeepZoomWriter(const std::string& path, const cv::Size& size, int quality) :
+    _path(path), _tilesPath(path.substr(0, path.find_last_of('.')) + "_files"), _size(size), _quality(quality), _finished(false)
+{
+    if (size.width <= 0 || size.height <= 0)
+        throw CustomException("Invalid Deep Zoom size : " + std::to_string(size.width) + "*" + std::to_string(size.height), CustomException::Level::ERROR);
+
+    //Level sizes are halved with rounding up until 1*1
+    std::vector<cv::Size> sizes(1, size);
+    while (sizes.back().width > 1 || sizes.back().height > 1)
+        sizes.emplace_back((sizes.back().width + 1) / 2, (sizes.back().height + 1) / 2);
+    std::reverse(sizes.begin(), sizes.end());
+
+    std::filesystem::create_directory(_tilesPath);
+    _levels.resize(sizes.size());
+    for (int l = 0; l < (int)_levels.size(); l++)
+    {
+        Level& level = _levels[l];
+        level._size = sizes[l];
+        level._strip.create(std::min(TileSize, level._size.height), level._size.width, CV_8UC3);
+        if (l > 0)
+        {
+            level._pendingRow.resize(3 * level._size.width);
+            level._downsampledRow.resize(3 * sizes[l - 1].width);
+        }
+
+        const std::string levelPath = _tilesPath + "\\" + std::to_string(l);
+        std::filesystem::create_directory(levelPath);
+        if (!std::filesystem::exists(levelPath))
+            throw CustomException("Impossible to create directory : " + levelPath, CustomException::Level::ERROR);
+    }
+}
+
+DeepZoomWriter::~DeepZoomWriter()
+{
+}
+
+void DeepZoomWriter::write(const cv::Mat& band)
+{
+    const int top = (int)_levels.size() - 1;
+    if (_finished || band.cols != _size.width || band.type() != CV_8UC3 || _levels[top]._nbRows + band.rows > _size.height)
+        throw CustomException("Invalid band written to " + _path, CustomException::Level::ERROR);
+
+    for (int i = 0; i < band.rows; i++)
+        addRow(top, band.ptr(i));
+}
+
+void DeepZoomWriter::finish()
+{
+    if (_finished)
+        return;
+
+    //Last odd rows are downsampled with themselves, from full resolution down to 1*1
+    for (int l = (int)_levels.size() - 1; l > 0; l--)
+    {
+        Level& level = _levels[l];
+        if (level._nbRows % 2 == 1)
+        {
+            downsampleRows(l, level._pendingRow.data(), level._pendingRow.data());
+            addRow(l - 1, level._downsampledRow.data());
+        }
+    }
+
+    for (int l = 0; l < (int)_levels.size(); l++)
+    {
+        if (_levels[l]._nbRows != _levels[l]._size.height)
+            throw CustomException("Missing rows in " + _path + " level " + std::to_string(l) + " : " + std::to_string(_levels[l]._nbRows) + "/" + std::to_string(_levels[l]._size.height), CustomException::Level::ERROR);
+        if (_levels[l]._nbStripRows > 0)
+            flushStrip(l);
+    }
+
+    writeDescriptor();
+    _finished = true;
+}
+
+void DeepZoomWriter::addRow(int l, const unsigned char* row)
+{
+    Level& level = _levels[l];
+    const int rowSize = 3 * level._size.width;
+    std::copy(row, row + rowSize, level._strip.ptr(level._nbStripRows));
+    level._nbStripRows++;
+    level._nbRows++;
+    if (level._nbStripRows == TileSize)
+        flushStrip(l);
+
+    if (l == 0)
+        return;
+
+    if (level._nbRows % 2 == 1)
+    {
+        std::copy(row, row + rowSize, level._pendingRow.begin());
+    }
+    else
+    {
+        downsampleRows(l, level._pendingRow.data(), row);
+        addRow(l - 1, level._downsampledRow.data());
+    }
+}
+
+void DeepZoomWriter::downsampleRows(int l, const unsigned char* row0, const unsigned char* row1)
+{
+    //2*2 box filter, last column is repeated for odd widths
+    Level& level = _levels[l];
+    const int width = level._size.width;
+    const int downsampledWidth = _levels[l - 1]._size.width;
+    for (int x = 0; x < downsampledWidth; x++)
+    {
+        const int p0 = 3 * (2 * x);
+        const int p1 = 3 * std::min(2 * x + 1, width - 1);
+        for (int c = 0; c < 3; c++)
+            level._downsampledRow[3 * x + c] = (unsigned char)((row0[p0 + c] + row0[p1 + c] + row1[p0 + c] + row1[p1 + c] + 2) / 4);
+    }
+}
+
+void DeepZoomWriter::flushStrip(int l)
+{
+    Level& level = _levels[l];
+    const int nbColumns = (level._size.width + TileSize - 1) / TileSize;
+    const std::string levelPath = _tilesPath + "\\" + std::to_string(l) + "\\";
+
+    SystemUtils::ParallelErrors errors;
+    #pragma omp parallel for
+    for (int column = 0; column < nbColumns; column++)
+    {
+        errors.run([&]()
+            {
+                const cv::Rect box(column * TileSize, 0, std::min(TileSize, level._size.width - column * TileSize), level._nbStripRows);
+                const std::string tilePath = levelPath + std::to_string(column) + "_" + std::to_string(level._nbStrips) + ".jpg";
+                if (!cv::imwrite(tilePath, level._strip(box), std::vector<int>({cv::IMWRITE_JPEG_QUALITY, _quality})))
+                    throw CustomException("Impossible to create Deep Zoom tile : " + tilePath, CustomException::Level::ERROR);
+            });
+    }
+    errors.rethrow();
+
+    level._nbStrips++;
+    level._nbStripRows = 0;
+}
+
+void DeepZoomWriter::writeDescriptor() const
+{
+    std::ofstream descriptor(_path, std::ios::trunc);
+    if (!descriptor.is_open())
+        throw CustomException("Impossible to create file : " + _path, CustomException::Level::ERROR);
+
+    descriptor << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    descriptor << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" TileSize=\"" << TileSize << "\" Overlap=\"" << TileOverlap << "\" Format=\"jpg\">\n";
+    descriptor << "    <Size Width=\"" << _size.width << "\" Height=\"" << _size.height << "\"/>\n";
+    descriptor << "</Image>\n";
+}
@@ -4,6 +4,7 @@
 #include "ProgressBar.h"
 #include "Log.h"
 #include "Console.h"
+#include "SystemUtils.h"
 #include <stack>
 
 
@@ -18,22 +19,27 @@ void DuplicateRemover::run(Tiles& tiles) const
     Console::Out::startBar(Console::DEFAULT);
 
     OutputManager::get().cstderr_silent();
+    SystemUtils::ParallelErrors errors;
     #pragma omp parallel for
     for (int t = 0; t < tiles.getNbTiles(); t++)
     {
-        cv::Mat tile;
-        tiles.readImage(t, tile);
-        if (!tile.empty())
-        {
-            ImageUtils::DHash(tile, hashes[t]);
-        }   
-        else
-        {
-            isEmpty[t] = true;
-        }
-        Console::Out::addBarSteps(1);
+        errors.run([&]()
+            {
+                cv::Mat tile;
+                tiles.readImage(t, tile);
+                if (!tile.empty())
+                {
+                    ImageUtils::DHash(tile, hashes[t]);
+                }
+                else
+                {
+                    isEmpty[t] = true;
+                }
+                Console::Out::addBarSteps(1);
+            });
     }
     OutputManager::get().cstderr_restore();
+    errors.rethrow();
     Log::Logger::get().log(Log::TRACE) << "Tiles DHash computed.";
 
     for (int t1 = 0; t1 < tiles.getNbTiles() - 1; t1++)
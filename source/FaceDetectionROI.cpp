@@ -22,6 +22,10 @@ FaceDetectionROI::~FaceDetectionROI()
 
 void FaceDetectionROI::initialize()
 {
+    //Loaded once, server workers keep their detectors resident between jobs
+    if (!_faceDetectors.empty())
+        return;
+
     std::string processPath = SystemUtils::getCurrentProcessDirectory();
     const int nbThreads = omp_get_max_threads();
     _faceDetectors.resize(nbThreads);
@@ -36,26 +40,23 @@ void FaceDetectionROI::initialize()
 
 void FaceDetectionROI::find(const cv::Mat& image, cv::Rect& box, bool rowDirSearch, int threadID) const
 {
-    //Test if face search is needed
+    Detection detection;
+    find(image, box, rowDirSearch, threadID, detection);
+}
+
+void FaceDetectionROI::find(const cv::Mat& image, cv::Rect& box, bool rowDirSearch, int threadID, Detection& detection) const
+{
+    //Test if face search is needed, detectors are not loaded in preview mode
     double croppedRatio = rowDirSearch ? (double)box.height / (double)image.rows : (double)box.width / (double)image.cols;
 
-    if (croppedRatio < MinCroppedRatio)
+    if (croppedRatio < MinCroppedRatio && !_faceDetectors.empty())
     {
-        //Deep learning based face detection using YuNet
-        cv::Mat faces;
-        double maxSize = std::max(image.cols, image.rows);
-        double scale = _detectionSize / maxSize;
-        double scaleInv = maxSize / _detectionSize;
-        int sWidth = (int)std::round((double)image.cols * scale);
-        int sHeight = (int)std::round((double)image.rows * scale);
-        cv::Mat sImage;
-        ImageUtils::resample(sImage, cv::Size(sWidth, sHeight), image, ImageUtils::AREA);
-        _faceDetectors[threadID]->setInputSize(sImage.size());
-        _faceDetectors[threadID]->detect(sImage, faces);
-
-        if (!faces.empty())
+        if (!detection._done)
+            detect(image, detection, threadID);
+
+        if (!detection._faces.empty())
         {
-            getDetectionROI(image.size(), faces, box, scaleInv, rowDirSearch);
+            getDetectionROI(image.size(), detection._faces, box, detection._scaleInv, rowDirSearch);
             return;
         }
     }
@@ -63,6 +64,21 @@ void FaceDetectionROI::find(const cv::Mat& image, cv::Rect& box, bool rowDirSear
     getDefaultROI(image.size(), box, rowDirSearch);
 }
 
+void FaceDetectionROI::detect(const cv::Mat& image, Detection& detection, int threadID) const
+{
+    //Deep learning based face detection using YuNet
+    double maxSize = std::max(image.cols, image.rows);
+    double scale = _detectionSize / maxSize;
+    detection._scaleInv = maxSize / _detectionSize;
+    int sWidth = (int)std::round((double)image.cols * scale);
+    int sHeight = (int)std::round((double)image.rows * scale);
+    cv::Mat sImage;
+    ImageUtils::resample(sImage, cv::Size(sWidth, sHeight), image, ImageUtils::AREA);
+    _faceDetectors[threadID]->setInputSize(sImage.size());
+    _faceDetectors[threadID]->detect(sImage, detection._faces);
+    detection._done = true;
+}
+
 void FaceDetectionROI::getDetectionROI(const cv::Size& imageSize, const cv::Mat& faces, cv::Rect& box, double scaleInv, bool rowDirSearch) const
 {
     double minConfidence = (faces.at<float>(0, 14) >= HighFaceConfidence) ? HighFaceConfidence : LowFaceConfidence; // If there is no face detected with high confidence, try other detected faces !
@@ -0,0 +1,87 @@
+#include "HistogramTransfer.h"
+#include "ColorUtils.h"
+
+
+HistogramTransfer::Source::Source(const ProbaUtils::Histogram<3>& histogram) :
+    _histogram(histogram)
+{
+    for (auto& cdf : _cdfs)
+        cdf.fill(0);
+
+    const int nbValues = _histogram._values.size();
+    for (int h = 0; h < nbValues; h++)
+        for (int c = 0; c < 3; c++)
+            _cdfs[c][(int)_histogram._values[h](c)] += _histogram._counts[h];
+
+    normalizeCDFs(_cdfs);
+}
+
+HistogramTransfer::Source::~Source()
+{
+}
+
+ColorTransfer::CostProfile HistogramTransfer::getCostProfile()
+{
+    return {"histogram", false, "Channel cumulative distributions", "Channel cumulative distributions of cell pixels, 3 lookup tables"};
+}
+
+HistogramTransfer::HistogramTransfer(const Source& source, const cv::Mat& cell) :
+    _source(source)
+{
+    ChannelCDFs cellCDFs;
+    for (auto& cdf : cellCDFs)
+        cdf.fill(0);
+
+    const int nbPixels = cell.rows * cell.cols;
+    for (int p = 0; p < nbPixels; p++)
+        for (int c = 0; c < 3; c++)
+            cellCDFs[c][cell.data[3 * p + c]] += 1;
+
+    normalizeCDFs(cellCDFs);
+
+    //Each tile level is mapped to the first cell level reaching the same cumulated frequency
+    for (int c = 0; c < 3; c++)
+    {
+        for (int level = 0, cellLevel = 0; level < NbLevels; level++)
+        {
+            while (cellLevel < NbLevels - 1 && cellCDFs[c][cellLevel] < _source._cdfs[c][level])
+                cellLevel++;
+            _luts[c][level] = cellLevel;
+        }
+    }
+}
+
+HistogramTransfer::~HistogramTransfer()
+{
+}
+
+void HistogramTransfer::apply(cv::Mat& enhancedImage, double blending)
+{
+    std::array<std::array<uchar, NbLevels>, 3> luts;
+    for (int c = 0; c < 3; c++)
+        for (int level = 0; level < NbLevels; level++)
+            luts[c][level] = (uchar)ColorUtils::clip<int>((int)std::round((1. - blending) * level + blending * _luts[c][level]), 0, NbLevels - 1);
+
+    const ProbaUtils::Histogram<3>& histogram = _source._histogram;
+    const int nbPixels = enhancedImage.rows * enhancedImage.cols;
+    for (int p = 0, k = 0; p < nbPixels; p++)
+    {
+        const MathUtils::VectorNd<3>& pixel = histogram._values[histogram._mapId[p]];
+        for (int c = 0; c < 3; c++, k++)
+            enhancedImage.data[k] = luts[c][(int)pixel(c)];
+    }
+}
+
+void HistogramTransfer::normalizeCDFs(ChannelCDFs& cdfs)
+{
+    for (auto& cdf : cdfs)
+    {
+        for (int level = 1; level < NbLevels; level++)
+            cdf[level] += cdf[level - 1];
+
+        const double total = cdf[NbLevels - 1];
+        if (total > 0)
+            for (auto& frequency : cdf)
+                frequency /= total;
+    }
+}
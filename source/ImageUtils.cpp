@@ -1,10 +1,36 @@
 #include "ImageUtils.h"
 #include "ColorUtils.h"
 #include <numbers>
+#include <fstream>
+#include <cstring>
 
 
 namespace
 {
+    int readExifOrientation(const std::vector<unsigned char>& segment)
+    {
+        //TIFF header follows the Exif identifier, orientation is a short entry of the first IFD
+        const size_t tiff = 6;
+        if (segment.size() < tiff + 8 || std::memcmp(segment.data(), "Exif\0\0", 6) != 0)
+            return 1;
+
+        const bool littleEndian = segment[tiff] == 'I';
+        auto read16 = [&](size_t offset) { return littleEndian ? segment[offset] | segment[offset + 1] << 8 : segment[offset] << 8 | segment[offset + 1]; };
+        auto read32 = [&](size_t offset) { return littleEndian ? (size_t)read16(offset) | (size_t)read16(offset + 2) << 16 : (size_t)read16(offset) << 16 | (size_t)read16(offset + 2); };
+        const size_t ifd = tiff + read32(tiff + 4);
+        if (ifd + 2 > segment.size())
+            return 1;
+
+        const int nbEntries = read16(ifd);
+        for (int e = 0; e < nbEntries && ifd + 2 + 12 * (e + 1) <= segment.size(); e++)
+        {
+            const size_t entry = ifd + 2 + 12 * e;
+            if (read16(entry) == 0x0112)
+                return read16(entry + 8);
+        }
+        return 1;
+    }
+
     double sinc(double x)
     {
         if (x == 0.0)
@@ -485,6 +511,30 @@ namespace
             for (int j = 0; j < size.width * 3; j++, k++, w0++, w1++, w2++, w3++)
                 output[k] = (buffer[w0] + buffer[w3] - buffer[w1] - buffer[w2]) / kernel[k / 3];
     }
+
+    void boxDownsample(std::vector<double>& output, const double* input, const cv::Size& size, int factor)
+    {
+        //Each output pixel is the mean of a factor x factor block, blocks are truncated on borders
+        const int outWidth = (size.width + factor - 1) / factor;
+        const int outHeight = (size.height + factor - 1) / factor;
+        output.assign(outWidth * outHeight * 3, 0.);
+
+        for (int i = 0; i < size.height; i++)
+            for (int j = 0, k = i * size.width * 3; j < size.width; j++)
+                for (int c = 0; c < 3; c++, k++)
+                    output[((i / factor) * outWidth + j / factor) * 3 + c] += input[k];
+
+        for (int i = 0, k = 0; i < outHeight; i++)
+        {
+            const int iSize = std::min(factor, size.height - i * factor);
+            for (int j = 0; j < outWidth; j++)
+            {
+                const double invBlockSize = 1. / (iSize * std::min(factor, size.width - j * factor));
+                for (int c = 0; c < 3; c++, k++)
+                    output[k] *= invBlockSize;
+            }
+        }
+    }
 };
 
 
@@ -612,6 +662,53 @@ void ImageUtils::DHash(const cv::Mat& image, Hash& hash)
     }
 }
 
+bool ImageUtils::readJpegSize(const std::string& path, cv::Size& size)
+{
+    //Segments are read up to the frame header, EXIF orientations 5 to 8 swap sides as cv::imread rotates the image
+    std::ifstream stream(path, std::ios::binary);
+    if (stream.get() != 0xFF || stream.get() != 0xD8)
+        return false;
+
+    bool transposed = false;
+    std::vector<unsigned char> segment;
+    while (true)
+    {
+        int marker = stream.get();
+        if (marker != 0xFF)
+            return false;
+        while (marker == 0xFF)
+            marker = stream.get();
+        if (marker == EOF || marker == 0xD9 || marker == 0xDA)
+            return false;
+        if (marker == 0x01 || (0xD0 <= marker && marker <= 0xD7))
+            continue;
+
+        const int lengthHigh = stream.get();
+        const int lengthLow = stream.get();
+        const int length = ((lengthHigh << 8) | lengthLow) - 2;
+        if (lengthLow == EOF || length < 0)
+            return false;
+        segment.resize(length);
+        if (!stream.read(reinterpret_cast<char*>(segment.data()), length))
+            return false;
+
+        //Start of frame markers, except DHT, JPG and DAC
+        if (0xC0 <= marker && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+        {
+            if (length < 5)
+                return false;
+            const int height = (segment[1] << 8) | segment[2];
+            const int width = (segment[3] << 8) | segment[4];
+            if (width == 0 || height == 0)
+                return false;
+            size = transposed ? cv::Size(height, width) : cv::Size(width, height);
+            return true;
+        }
+        if (marker == 0xE1 && !transposed)
+            transposed = readExifOrientation(segment) >= 5;
+    }
+}
+
 void ImageUtils::guidedFiltering(std::vector<double>& filtered, const std::vector<double>& image, const std::vector<double>& guide, const cv::Size& size, int radius, double epsilon)
 {
     std::vector<int> kernel;
@@ -662,3 +759,299 @@ void ImageUtils::guidedFiltering(std::vector<double>& filtered, const std::vecto
     for (int i = 0; i < imageSize; i++)
         filtered[i] = alphaMean[i] * guide[i] + betaMean[i];
 }
+
+ImageUtils::GuidedFilter::GuidedFilter(const std::vector<double>& guide, const cv::Size& size, int radius, double epsilon, int subsampling) :
+    _size(size), _subsampling(std::max(subsampling, 1))
+{
+    const int nbPixels = _size.width * _size.height;
+    const int imageSize = nbPixels * 3;
+
+    for (int c = 0; c < 3; c++)
+        _guideShift[c] = 0;
+    for (int i = 0; i < imageSize; i++)
+        _guideShift[i % 3] += guide[i];
+    for (int c = 0; c < 3; c++)
+        _guideShift[c] /= std::max(nbPixels, 1);
+
+    _guide.resize(imageSize);
+    for (int i = 0; i < imageSize; i++)
+        _guide[i] = (float)(guide[i] - _guideShift[i % 3]);
+
+    //Fast guided filter : coefficients are computed on subsampled guide with scaled radius
+    std::vector<double> levelGuide;
+    if (_subsampling > 1)
+    {
+        boxDownsample(levelGuide, guide.data(), _size, _subsampling);
+        _level._size = cv::Size((_size.width + _subsampling - 1) / _subsampling, (_size.height + _subsampling - 1) / _subsampling);
+        _level._radius = std::max(radius / _subsampling, 1);
+    }
+    else
+    {
+        levelGuide = guide;
+        _level._size = _size;
+        _level._radius = radius;
+    }
+
+    //Guide terms are computed once in double precision
+    const int levelSize = _level._size.width * _level._size.height * 3;
+    const int rowSize = _level._size.width * 3;
+    std::vector<int> kernel;
+    std::vector<double> buffer((_level._size.width + 2 * _level._radius + 1) * (_level._size.height + 2 * _level._radius + 1) * 3);
+    std::vector<double> sqGuide(levelSize);
+    std::vector<double> guideMean(levelSize);
+    std::vector<double> guideCorr(levelSize);
+
+    for (int i = 0; i < levelSize; i++)
+        sqGuide[i] = levelGuide[i] * levelGuide[i];
+
+    computeKernel(kernel, _level._size, _level._radius);
+    averageFilter(guideMean, buffer, levelGuide, kernel, _level._size, _level._radius);
+    averageFilter(guideCorr, buffer, sqGuide, kernel, _level._size, _level._radius);
+
+    if (_subsampling > 1)
+    {
+        _levelGuide.resize(levelSize);
+        for (int i = 0; i < levelSize; i++)
+            _levelGuide[i] = (float)(levelGuide[i] - _guideShift[i % 3]);
+    }
+    _level._guideMean.resize(levelSize);
+    _level._guideVarEps.resize(levelSize);
+    for (int i = 0; i < levelSize; i++)
+    {
+        _level._guideMean[i] = (float)(guideMean[i] - _guideShift[i % 3]);
+        _level._guideVarEps[i] = (float)(guideCorr[i] - guideMean[i] * guideMean[i] + epsilon);
+    }
+
+    _level._invColCounts.resize(_level._size.width);
+    for (int j = 0; j < _level._size.width; j++)
+        _level._invColCounts[j] = 1.f / (float)(std::min(j + _level._radius, _level._size.width - 1) - std::max(j - _level._radius, 0) + 1);
+
+}
+
+ImageUtils::GuidedFilter::~GuidedFilter()
+{
+}
+
+void ImageUtils::GuidedFilter::apply(std::vector<double>& filtered, const std::vector<double>& image, Buffers& buffers) const
+{
+    const int nbPixels = _size.width * _size.height;
+    filtered.resize(nbPixels * 3);
+    initializeBuffers(buffers);
+
+    double imageMean[3] = {0, 0, 0};
+    for (int i = 0; i < nbPixels * 3; i++)
+        imageMean[i % 3] += image[i];
+    for (int k = 0; k < _size.width * 3; k++)
+        buffers._imageShift[k] = (float)(imageMean[k % 3] / std::max(nbPixels, 1));
+
+    if (_subsampling > 1)
+    {
+        boxDownsample(buffers._levelImage, image.data(), _size, _subsampling);
+        computeCoefficients(buffers._levelImage.data(), filtered.data(), buffers);
+        upsampleCoefficients(filtered.data(), buffers);
+    }
+    else
+    {
+        computeCoefficients(image.data(), filtered.data(), buffers);
+    }
+}
+
+void ImageUtils::GuidedFilter::initializeBuffers(Buffers& buffers) const
+{
+    //Streaming buffers : column sums, row buffers and alpha / beta rings of 2 * radius + 1 rows
+    const int rowSize = _level._size.width * 3;
+    const int ringSize = (2 * _level._radius + 1) * rowSize;
+    buffers._imageShift.resize(_size.width * 3);
+    buffers._imgSums.resize(rowSize);
+    buffers._imgGuideSums.resize(rowSize);
+    buffers._alphaSums.resize(rowSize);
+    buffers._betaSums.resize(rowSize);
+    buffers._rowBuffer0.resize(rowSize);
+    buffers._rowBuffer1.resize(rowSize);
+    buffers._alphaRing.resize(ringSize);
+    buffers._betaRing.resize(ringSize);
+    if (_subsampling > 1)
+    {
+        const int levelSize = _level._size.height * rowSize;
+        buffers._alphaMean.resize(levelSize);
+        buffers._betaMean.resize(levelSize);
+    }
+}
+
+void ImageUtils::GuidedFilter::computeCoefficients(const double* image, double* filtered, Buffers& buffers) const
+{
+    const int width = _level._size.width;
+    const int height = _level._size.height;
+    const int radius = _level._radius;
+    const int rowSize = width * 3;
+    const int nbRingRows = 2 * radius + 1;
+
+    std::fill(buffers._imgSums.begin(), buffers._imgSums.end(), 0.f);
+    std::fill(buffers._imgGuideSums.begin(), buffers._imgGuideSums.end(), 0.f);
+    std::fill(buffers._alphaSums.begin(), buffers._alphaSums.end(), 0.f);
+    std::fill(buffers._betaSums.begin(), buffers._betaSums.end(), 0.f);
+
+    //Column sums of image and image * guide, rows are added when entering the window and removed when leaving it
+    auto accumulateImageRow = [&](int i, float sign)
+        {
+            const double* img = image + i * rowSize;
+            const float* guideRow = (_subsampling > 1 ? _levelGuide.data() : _guide.data()) + i * rowSize;
+            const float* imageShift = buffers._imageShift.data();
+            float* imgSums = buffers._imgSums.data();
+            float* imgGuideSums = buffers._imgGuideSums.data();
+            for (int k = 0; k < rowSize; k++)
+            {
+                const float value = sign * ((float)img[k] - imageShift[k]);
+                imgSums[k] += value;
+                imgGuideSums[k] += value * guideRow[k];
+            }
+        };
+
+    auto accumulateAlphaBetaRow = [&](int i, float sign)
+        {
+            const float* alpha = buffers._alphaRing.data() + (i % nbRingRows) * rowSize;
+            const float* beta = buffers._betaRing.data() + (i % nbRingRows) * rowSize;
+            float* alphaSums = buffers._alphaSums.data();
+            float* betaSums = buffers._betaSums.data();
+            for (int k = 0; k < rowSize; k++)
+            {
+                alphaSums[k] += sign * alpha[k];
+                betaSums[k] += sign * beta[k];
+            }
+        };
+
+    auto invRowCount = [&](int i)
+        {
+            return 1.f / (float)(std::min(i + radius, height - 1) - std::max(i - radius, 0) + 1);
+        };
+
+    //Mean coefficients of row i only depend on alpha / beta rows [i - radius, i + radius]
+    auto outputRow = [&](int i)
+        {
+            const float invCount = invRowCount(i);
+            boxFilterRow(buffers._rowBuffer0.data(), buffers._alphaSums.data(), invCount);
+            boxFilterRow(buffers._rowBuffer1.data(), buffers._betaSums.data(), invCount);
+            storeCoefficientsRow(i, buffers._rowBuffer0.data(), buffers._rowBuffer1.data(), filtered, buffers);
+        };
+
+    for (int i = 0; i < std::min(radius, height); i++)
+        accumulateImageRow(i, 1.f);
+
+    for (int i = 0; i < height; i++)
+    {
+        if (i + radius < height)
+            accumulateImageRow(i + radius, 1.f);
+        if (i - radius - 1 >= 0)
+            accumulateImageRow(i - radius - 1, -1.f);
+
+        //Fused image means, covariance, alpha and beta for row i
+        const float invCount = invRowCount(i);
+        boxFilterRow(buffers._rowBuffer0.data(), buffers._imgSums.data(), invCount);
+        boxFilterRow(buffers._rowBuffer1.data(), buffers._imgGuideSums.data(), invCount);
+
+        if (i - nbRingRows >= 0)
+            accumulateAlphaBetaRow(i - nbRingRows, -1.f);
+
+        const float* imgMean = buffers._rowBuffer0.data();
+        const float* imgGuideCorr = buffers._rowBuffer1.data();
+        const float* guideMean = _level._guideMean.data() + i * rowSize;
+        const float* guideVarEps = _level._guideVarEps.data() + i * rowSize;
+        float* alpha = buffers._alphaRing.data() + (i % nbRingRows) * rowSize;
+        float* beta = buffers._betaRing.data() + (i % nbRingRows) * rowSize;
+        for (int k = 0; k < rowSize; k++)
+        {
+            alpha[k] = (imgGuideCorr[k] - imgMean[k] * guideMean[k]) / guideVarEps[k];
+            beta[k] = imgMean[k] - alpha[k] * guideMean[k];
+        }
+        accumulateAlphaBetaRow(i, 1.f);
+
+        if (i - radius >= 0)
+            outputRow(i - radius);
+    }
+
+    for (int i = std::max(height - radius, 0); i < height; i++)
+    {
+        if (i - radius - 1 >= 0)
+            accumulateAlphaBetaRow(i - radius - 1, -1.f);
+        outputRow(i);
+    }
+}
+
+void ImageUtils::GuidedFilter::boxFilterRow(float* output, const float* colSums, float invRowCount) const
+{
+    //Sliding window along the row, window is truncated on borders
+    const int width = _level._size.width;
+    const int radius = _level._radius;
+    float sums[3] = {0, 0, 0};
+    for (int j = 0; j < std::min(radius, width); j++)
+        for (int c = 0; c < 3; c++)
+            sums[c] += colSums[3 * j + c];
+
+    for (int j = 0; j < width; j++)
+    {
+        if (j + radius < width)
+            for (int c = 0; c < 3; c++)
+                sums[c] += colSums[3 * (j + radius) + c];
+        if (j - radius - 1 >= 0)
+            for (int c = 0; c < 3; c++)
+                sums[c] -= colSums[3 * (j - radius - 1) + c];
+
+        const float invCount = invRowCount * _level._invColCounts[j];
+        for (int c = 0; c < 3; c++)
+            output[3 * j + c] = sums[c] * invCount;
+    }
+}
+
+void ImageUtils::GuidedFilter::storeCoefficientsRow(int i, const float* alphaMean, const float* betaMean, double* filtered, Buffers& buffers) const
+{
+    const int rowSize = _level._size.width * 3;
+    if (_subsampling > 1)
+    {
+        std::copy(alphaMean, alphaMean + rowSize, buffers._alphaMean.data() + i * rowSize);
+        std::copy(betaMean, betaMean + rowSize, buffers._betaMean.data() + i * rowSize);
+        return;
+    }
+
+    const float* guide = _guide.data() + i * rowSize;
+    const float* shift = buffers._imageShift.data();
+    double* output = filtered + i * rowSize;
+    for (int k = 0; k < rowSize; k++)
+        output[k] = (double)(alphaMean[k] * guide[k] + betaMean[k] + shift[k]);
+}
+
+void ImageUtils::GuidedFilter::upsampleCoefficients(double* filtered, const Buffers& buffers) const
+{
+    //Bilinear interpolation of mean coefficients, subsampled pixel centers are aligned with block centers
+    const int levelWidth = _level._size.width;
+    const int levelHeight = _level._size.height;
+    const float invFactor = 1.f / (float)_subsampling;
+    const std::vector<float>& alphaMean = buffers._alphaMean;
+    const std::vector<float>& betaMean = buffers._betaMean;
+
+    for (int i = 0, k = 0; i < _size.height; i++)
+    {
+        const float y = std::clamp(((float)i + 0.5f) * invFactor - 0.5f, 0.f, (float)(levelHeight - 1));
+        const int y0 = std::min((int)y, levelHeight - 1);
+        const int y1 = std::min(y0 + 1, levelHeight - 1);
+        const float wy = y - (float)y0;
+
+        for (int j = 0; j < _size.width; j++)
+        {
+            const float x = std::clamp(((float)j + 0.5f) * invFactor - 0.5f, 0.f, (float)(levelWidth - 1));
+            const int x0 = std::min((int)x, levelWidth - 1);
+            const int x1 = std::min(x0 + 1, levelWidth - 1);
+            const float wx = x - (float)x0;
+
+            const int p00 = (y0 * levelWidth + x0) * 3;
+            const int p01 = (y0 * levelWidth + x1) * 3;
+            const int p10 = (y1 * levelWidth + x0) * 3;
+            const int p11 = (y1 * levelWidth + x1) * 3;
+            for (int c = 0; c < 3; c++, k++)
+            {
+                const float alpha = (1.f - wy) * ((1.f - wx) * alphaMean[p00 + c] + wx * alphaMean[p01 + c]) + wy * ((1.f - wx) * alphaMean[p10 + c] + wx * alphaMean[p11 + c]);
+                const float beta = (1.f - wy) * ((1.f - wx) * betaMean[p00 + c] + wx * betaMean[p01 + c]) + wy * ((1.f - wx) * betaMean[p10 + c] + wx * betaMean[p11 + c]);
+                filtered[k] = (double)(alpha * _guide[k] + beta + buffers._imageShift[c]);
+            }
+        }
+    }
+}
@@ -0,0 +1,425 @@
+#include "JpegWriter.h"
+#include "CustomException.h"
+#include "SystemUtils.h"
+#include <filesystem>
+#include <bit>
+#include <cmath>
+#include <algorithm>
+#include <omp.h>
+
+
+namespace
+{
+    const unsigned char LumaReference[64] = {
+        16, 11, 10, 16, 24, 40, 51, 61,
+        12, 12, 14, 19, 26, 58, 60, 55,
+        14, 13, 16, 24, 40, 57, 69, 56,
+        14, 17, 22, 29, 51, 87, 80, 62,
+        18, 22, 37, 56, 68, 109, 103, 77,
+        24, 35, 55, 64, 81, 104, 113, 92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103, 99};
+
+    const unsigned char ChromaReference[64] = {
+        17, 18, 24, 47, 99, 99, 99, 99,
+        18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99,
+        47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99};
+
+    //Standard Huffman tables (ITU T.81 annex K)
+    const unsigned char LumaDCBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+    const unsigned char ChromaDCBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+    const unsigned char DCValues[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+    const unsigned char LumaACBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+    const unsigned char LumaACValues[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa};
+
+    const unsigned char ChromaACBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+    const unsigned char ChromaACValues[162] = {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+        0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+        0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+        0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+        0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa};
+
+    //AAN scale factors, cos(k*pi/16)*sqrt(2) and 1 for k=0, folded into quantization
+    const double AANScales[8] = {1., 1.387039845, 1.306562965, 1.175875602, 1., 0.785694958, 0.541196100, 0.275899379};
+
+    void forwardDCT8(float* data, int stride)
+    {
+        //Arai-Agui-Nakajima 1D DCT, outputs are scaled by 8*AANScales[u] relative to the orthonormal DCT
+        const float tmp0 = data[0] + data[7 * stride], tmp7 = data[0] - data[7 * stride];
+        const float tmp1 = data[stride] + data[6 * stride], tmp6 = data[stride] - data[6 * stride];
+        const float tmp2 = data[2 * stride] + data[5 * stride], tmp5 = data[2 * stride] - data[5 * stride];
+        const float tmp3 = data[3 * stride] + data[4 * stride], tmp4 = data[3 * stride] - data[4 * stride];
+
+        //Even part
+        const float tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+        const float tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+        data[0] = tmp10 + tmp11;
+        data[4 * stride] = tmp10 - tmp11;
+        const float z1 = (tmp12 + tmp13) * 0.707106781f;
+        data[2 * stride] = tmp13 + z1;
+        data[6 * stride] = tmp13 - z1;
+
+        //Odd part
+        const float odd10 = tmp4 + tmp5, odd11 = tmp5 + tmp6, odd12 = tmp6 + tmp7;
+        const float z5 = (odd10 - odd12) * 0.382683433f;
+        const float z2 = 0.541196100f * odd10 + z5;
+        const float z4 = 1.306562965f * odd12 + z5;
+        const float z3 = odd11 * 0.707106781f;
+        const float z11 = tmp7 + z3, z13 = tmp7 - z3;
+        data[5 * stride] = z13 + z2;
+        data[3 * stride] = z13 - z2;
+        data[stride] = z11 + z4;
+        data[7 * stride] = z11 - z4;
+    }
+
+    void writeMarker(std::ofstream& stream, unsigned char marker)
+    {
+        stream.put((char)0xFF);
+        stream.put((char)marker);
+    }
+
+    void writeWord(std::ofstream& stream, int value)
+    {
+        stream.put((char)((value >> 8) & 0xFF));
+        stream.put((char)(value & 0xFF));
+    }
+}
+
+
+JpegWriter::JpegWriter(const std::string& path, const cv::Size& size, int quality) :
+    _path(path), _temporaryPath(path + ".part"), _size(size), _nbMCURows((size.height + BlockSize - 1) / BlockSize), _nbPendingRows(0), _nbWrittenRows(0), _nbWrittenMCURows(0), _finished(false)
+{
+    if (size.width <= 0 || size.height <= 0 || size.width > 65535 || size.height > 65535)
+        throw CustomException("Invalid JPEG size : " + std::to_string(size.width) + "*" + std::to_string(size.height), CustomException::Level::ERROR);
+
+    //Encoded to a temporary file renamed by finish, an interrupted mosaic never leaves a truncated JPEG under its final name
+    _stream.open(_temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!_stream.is_open())
+        throw CustomException("Impossible to create file : " + _temporaryPath, CustomException::Level::ERROR);
+
+    computeQuantization(_lumaQuantization, _lumaTable, LumaReference, quality);
+    computeQuantization(_chromaQuantization, _chromaTable, ChromaReference, quality);
+    buildHuffmanTable(_lumaDC, LumaDCBits, DCValues);
+    buildHuffmanTable(_lumaAC, LumaACBits, LumaACValues);
+    buildHuffmanTable(_chromaDC, ChromaDCBits, DCValues);
+    buildHuffmanTable(_chromaAC, ChromaACBits, ChromaACValues);
+    _pendingRows.resize(BlockSize * _size.width * 3);
+
+    writeHeaders();
+}
+
+JpegWriter::~JpegWriter()
+{
+    if (_stream.is_open())
+        _stream.close();
+
+    if (!_finished)
+    {
+        std::error_code error;
+        std::filesystem::remove(_temporaryPath, error);
+    }
+}
+
+void JpegWriter::write(const cv::Mat& band)
+{
+    if (_finished || band.cols != _size.width || band.type() != CV_8UC3 || _nbWrittenRows + _nbPendingRows + band.rows > _size.height)
+        throw CustomException("Invalid band written to " + _path, CustomException::Level::ERROR);
+
+    //Bands are accumulated until there are enough MCU rows to keep all threads busy, then encoded at once
+    const size_t rowSize = 3 * _size.width;
+    if (_pendingRows.size() < (_nbPendingRows + band.rows) * rowSize)
+        _pendingRows.resize((_nbPendingRows + band.rows) * rowSize);
+    for (int i = 0; i < band.rows; i++)
+        std::copy(band.ptr(i), band.ptr(i) + rowSize, _pendingRows.data() + (_nbPendingRows + i) * rowSize);
+    _nbPendingRows += band.rows;
+
+    const int nbMCURows = _nbPendingRows / BlockSize;
+    if (nbMCURows >= MCURowsPerThread * omp_get_max_threads())
+        encodePendingRows(nbMCURows * BlockSize);
+}
+
+void JpegWriter::finish()
+{
+    if (_finished)
+        return;
+
+    if (_nbPendingRows > 0)
+        encodePendingRows(_nbPendingRows);
+    if (_nbWrittenRows != _size.height)
+        throw CustomException("Missing rows in " + _path + " : " + std::to_string(_nbWrittenRows) + "/" + std::to_string(_size.height), CustomException::Level::ERROR);
+
+    writeMarker(_stream, 0xD9);
+    _stream.close();
+    if (_stream.fail())
+        throw CustomException("Impossible to write file : " + _temporaryPath, CustomException::Level::ERROR);
+
+    std::error_code error;
+    std::filesystem::rename(_temporaryPath, _path, error);
+    if (error)
+        throw CustomException("Impossible to rename " + _temporaryPath + " to " + _path + " : " + error.message(), CustomException::Level::ERROR);
+    _finished = true;
+}
+
+void JpegWriter::encodePendingRows(int nbRows)
+{
+    //Only the last MCU row of the image may be incomplete
+    const size_t rowSize = 3 * _size.width;
+    std::vector<const unsigned char*> rows(nbRows);
+    for (int i = 0; i < nbRows; i++)
+        rows[i] = _pendingRows.data() + i * rowSize;
+    const int nbMCURows = (nbRows + BlockSize - 1) / BlockSize;
+    encodeMCURows(rows.data(), nbMCURows, nbRows - (nbMCURows - 1) * BlockSize);
+
+    //Rows of an incomplete MCU row wait at the front for the next band
+    std::copy(_pendingRows.begin() + nbRows * rowSize, _pendingRows.begin() + _nbPendingRows * rowSize, _pendingRows.begin());
+    _nbPendingRows -= nbRows;
+}
+
+void JpegWriter::BitWriter::put(unsigned int bits, int nbBits)
+{
+    _buffer = (_buffer << nbBits) | (bits & ((1ull << nbBits) - 1));
+    _nbBits += nbBits;
+    while (_nbBits >= 8)
+    {
+        const unsigned char byte = (unsigned char)(_buffer >> (_nbBits - 8));
+        _bytes.push_back(byte);
+        if (byte == 0xFF)
+            _bytes.push_back(0x00); //Byte stuffing
+        _nbBits -= 8;
+    }
+}
+
+void JpegWriter::BitWriter::flush()
+{
+    if (_nbBits > 0)
+        put(0x7F, 8 - _nbBits); //Padding with 1 bits
+}
+
+void JpegWriter::buildHuffmanTable(HuffmanTable& table, const unsigned char* bits, const unsigned char* values)
+{
+    //Canonical codes, lengths are given by bits counts
+    unsigned short code = 0;
+    for (int length = 1, v = 0; length <= 16; length++)
+    {
+        for (int i = 0; i < bits[length - 1]; i++, v++)
+        {
+            table._codes[values[v]] = code++;
+            table._lengths[values[v]] = length;
+        }
+        code <<= 1;
+    }
+}
+
+void JpegWriter::computeQuantization(float* quantization, unsigned char* table, const unsigned char* reference, int quality)
+{
+    //IJG quality scaling, quantization divisors also remove the AAN DCT output scaling
+    quality = std::clamp(quality, 1, 100);
+    const int scale = (quality < 50) ? 5000 / quality : 200 - 2 * quality;
+    for (int i = 0; i < NbCoefficients; i++)
+    {
+        table[i] = (unsigned char)std::clamp((reference[i] * scale + 50) / 100, 1, 255);
+        quantization[i] = (float)(1. / (table[i] * AANScales[i / BlockSize] * AANScales[i % BlockSize] * 8.));
+    }
+}
+
+void JpegWriter::writeHeaders()
+{
+    writeMarker(_stream, 0xD8);
+
+    //JFIF header
+    writeMarker(_stream, 0xE0);
+    writeWord(_stream, 16);
+    _stream.write("JFIF", 5);
+    const char version[9] = {1, 1, 0, 0, 1, 0, 1, 0, 0};
+    _stream.write(version, 9);
+
+    //Quantization tables, zigzag order
+    writeMarker(_stream, 0xDB);
+    writeWord(_stream, 2 + 2 * (1 + NbCoefficients));
+    for (int t = 0; t < 2; t++)
+    {
+        const unsigned char* table = (t == 0) ? _lumaTable : _chromaTable;
+        _stream.put((char)t);
+        for (int k = 0; k < NbCoefficients; k++)
+            _stream.put((char)table[ZigZag[k]]);
+    }
+
+    //Frame header, 3 components without subsampling
+    writeMarker(_stream, 0xC0);
+    writeWord(_stream, 17);
+    _stream.put(8);
+    writeWord(_stream, _size.height);
+    writeWord(_stream, _size.width);
+    _stream.put(3);
+    for (int c = 0; c < 3; c++)
+    {
+        _stream.put((char)(c + 1));
+        _stream.put(0x11);
+        _stream.put((char)(c == 0 ? 0 : 1));
+    }
+
+    //Huffman tables
+    const unsigned char* bits[4] = {LumaDCBits, LumaACBits, ChromaDCBits, ChromaACBits};
+    const unsigned char* values[4] = {DCValues, LumaACValues, DCValues, ChromaACValues};
+    const unsigned char classIds[4] = {0x00, 0x10, 0x01, 0x11};
+    int length = 2;
+    for (int t = 0; t < 4; t++)
+    {
+        length += 17;
+        for (int i = 0; i < 16; i++)
+            length += bits[t][i];
+    }
+    writeMarker(_stream, 0xC4);
+    writeWord(_stream, length);
+    for (int t = 0; t < 4; t++)
+    {
+        int nbValues = 0;
+        _stream.put((char)classIds[t]);
+        for (int i = 0; i < 16; i++)
+        {
+            _stream.put((char)bits[t][i]);
+            nbValues += bits[t][i];
+        }
+        _stream.write(reinterpret_cast<const char*>(values[t]), nbValues);
+    }
+
+    //One restart interval per MCU row
+    writeMarker(_stream, 0xDD);
+    writeWord(_stream, 4);
+    writeWord(_stream, (_size.width + BlockSize - 1) / BlockSize);
+
+    //Scan header
+    writeMarker(_stream, 0xDA);
+    writeWord(_stream, 12);
+    _stream.put(3);
+    for (int c = 0; c < 3; c++)
+    {
+        _stream.put((char)(c + 1));
+        _stream.put((char)(c == 0 ? 0x00 : 0x11));
+    }
+    _stream.put(0);
+    _stream.put(63);
+    _stream.put(0);
+}
+
+void JpegWriter::encodeMCURows(const unsigned char* const* rows, int nbMCURows, int nbLastRows)
+{
+    std::vector<BitWriter> writers(nbMCURows);
+    SystemUtils::ParallelErrors errors;
+    #pragma omp parallel for
+    for (int m = 0; m < nbMCURows; m++)
+        errors.run([&]() { encodeMCURow(writers[m], rows + m * BlockSize, (m == nbMCURows - 1) ? nbLastRows : BlockSize); });
+    errors.rethrow();
+
+    //Intervals are concatenated in order, separated by cycling restart markers
+    for (int m = 0; m < nbMCURows; m++, _nbWrittenMCURows++)
+    {
+        _stream.write(reinterpret_cast<const char*>(writers[m]._bytes.data()), writers[m]._bytes.size());
+        if (_nbWrittenMCURows < _nbMCURows - 1)
+            writeMarker(_stream, (unsigned char)(0xD0 + _nbWrittenMCURows % 8));
+    }
+    _nbWrittenRows += (nbMCURows > 0) ? (nbMCURows - 1) * BlockSize + nbLastRows : 0;
+}
+
+void JpegWriter::encodeMCURow(BitWriter& writer, const unsigned char* const* rows, int nbRows) const
+{
+    //Rows and columns are padded by edge replication, DC predictors are reset at each restart interval
+    const int nbBlocks = (_size.width + BlockSize - 1) / BlockSize;
+    int dcPredictors[3] = {0, 0, 0};
+    float blocks[3][NbCoefficients];
+    for (int b = 0; b < nbBlocks; b++)
+    {
+        for (int y = 0; y < BlockSize; y++)
+        {
+            const unsigned char* row = rows[std::min(y, nbRows - 1)];
+            for (int x = 0; x < BlockSize; x++)
+            {
+                const unsigned char* pixel = row + 3 * std::min(b * BlockSize + x, _size.width - 1);
+                const float blue = pixel[0], green = pixel[1], red = pixel[2];
+                blocks[0][y * BlockSize + x] = 0.299f * red + 0.587f * green + 0.114f * blue - 128.f;
+                blocks[1][y * BlockSize + x] = -0.168736f * red - 0.331264f * green + 0.5f * blue;
+                blocks[2][y * BlockSize + x] = 0.5f * red - 0.418688f * green - 0.081312f * blue;
+            }
+        }
+
+        encodeBlock(writer, blocks[0], _lumaQuantization, _lumaDC, _lumaAC, dcPredictors[0]);
+        encodeBlock(writer, blocks[1], _chromaQuantization, _chromaDC, _chromaAC, dcPredictors[1]);
+        encodeBlock(writer, blocks[2], _chromaQuantization, _chromaDC, _chromaAC, dcPredictors[2]);
+    }
+    writer.flush();
+}
+
+void JpegWriter::encodeBlock(BitWriter& writer, const float* block, const float* quantization, const HuffmanTable& dcTable, const HuffmanTable& acTable, int& dcPredictor) const
+{
+    //Separable 2D DCT on rows then columns
+    float dct[NbCoefficients];
+    std::copy(block, block + NbCoefficients, dct);
+    for (int y = 0; y < BlockSize; y++)
+        forwardDCT8(dct + y * BlockSize, 1);
+    for (int u = 0; u < BlockSize; u++)
+        forwardDCT8(dct + u, BlockSize);
+
+    int coefficients[NbCoefficients];
+    for (int i = 0; i < NbCoefficients; i++)
+    {
+        const float value = dct[i] * quantization[i];
+        coefficients[i] = (int)(value + (value < 0 ? -0.5f : 0.5f)); //Rounding half away from zero without a library call
+    }
+
+    //Huffman code and magnitude bits are put at once, at most 16 + 11 bits
+    auto putValue = [&writer](const HuffmanTable& table, int run, int value)
+        {
+            const int category = (int)std::bit_width((unsigned int)std::abs(value));
+            const int symbol = (run << 4) | category;
+            const unsigned int bits = (unsigned int)(value < 0 ? value - 1 : value) & ((1u << category) - 1);
+            writer.put(((unsigned int)table._codes[symbol] << category) | bits, table._lengths[symbol] + category);
+        };
+
+    const int dcDiff = coefficients[0] - dcPredictor;
+    dcPredictor = coefficients[0];
+    putValue(dcTable, 0, dcDiff);
+
+    int run = 0;
+    for (int k = 1; k < NbCoefficients; k++)
+    {
+        const int value = coefficients[ZigZag[k]];
+        if (value == 0)
+        {
+            run++;
+            continue;
+        }
+
+        for (; run > 15; run -= 16)
+            writer.put(acTable._codes[0xF0], acTable._lengths[0xF0]);
+
+        putValue(acTable, run, value);
+        run = 0;
+    }
+
+    if (run > 0)
+        writer.put(acTable._codes[0x00], acTable._lengths[0x00]);
+}
@@ -40,10 +40,15 @@ int MatchSolver::getRequiredNbTiles()
     return _redundancyMaskNbTiles;
 }
 
-void MatchSolver::solve(const Tiles& tiles)
+void MatchSolver::solve(const Tiles& tiles, const Photo& photo)
 {
     Console::Out::get(Console::DEFAULT) << "Computing tiles matching...";
     const int mosaicSize = _gridWidth * _gridHeight;
+    _photoFeatures.resize(mosaicSize * Tiles::NbFeatures);
+    for (int mosaicId = 0; mosaicId < mosaicSize; mosaicId++)
+        Tiles::computeFeatures(photo.getTile(mosaicId), &_photoFeatures[mosaicId * Tiles::NbFeatures]);
+    Log::Logger::get().log(Log::TRACE) << "Photo features computed.";
+
     _matchingIds.resize(mosaicSize, -1);
     std::vector<std::vector<MatchCandidate>> candidates(mosaicSize);
 
@@ -53,6 +58,17 @@ void MatchSolver::solve(const Tiles& tiles)
     Log::Logger::get().log(Log::TRACE) << "Best tiles found.";
 }
 
+void MatchSolver::restore(const std::vector<int>& matchingIds)
+{
+    if (matchingIds.size() != _gridWidth * _gridHeight)
+        throw CustomException("Restored matching does not fit grid size !", CustomException::Level::ERROR);
+
+    _matchingIds = matchingIds;
+    std::set<int> idSet(_matchingIds.begin(), _matchingIds.end());
+    _uniqueIds.assign(idSet.begin(), idSet.end());
+    Log::Logger::get().log(Log::TRACE) << "Tiles matching restored with " << _uniqueIds.size() << " unique tiles.";
+}
+
 const std::vector<int>& MatchSolver::getUniqueIds() const
 {
     return _uniqueIds;
@@ -92,7 +108,7 @@ void MatchSolver::findCandidateTiles(std::vector<std::vector<MatchCandidate>>& c
             for (int t = 0; t < tiles.getNbTiles(); t++)
             {
                 candidates[m][t]._id = t;
-                candidates[m][t]._dist = tiles.computeDistance(i, j, t);
+                candidates[m][t]._dist = tiles.computeDistance(&_photoFeatures[m * Tiles::NbFeatures], t);
             }
 
             std::sort(candidates[m].begin(), candidates[m].end());
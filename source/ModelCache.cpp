@@ -0,0 +1,155 @@
+#include "ModelCache.h"
+#include "Log.h"
+#include "SerializationUtils.h"
+#include "WindowsSafe.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+
+const std::string ModelCache::CacheDir = "PMG_cache";
+
+ModelCache::ModelCache(const std::string& path) :
+    _cachePath(path + CacheDir), _writable(true)
+{
+}
+
+ModelCache::~ModelCache()
+{
+}
+
+std::string ModelCache::computeKey(const cv::Mat& tile)
+{
+    //FNV-1a content hash, tile size is kept explicit in the key
+    constexpr uint64_t FnvOffset = 14695981039346656037ULL;
+    constexpr uint64_t FnvPrime = 1099511628211ULL;
+
+    uint64_t hash = FnvOffset;
+    const size_t nbBytes = (size_t)tile.rows * (size_t)tile.cols * (size_t)tile.channels();
+    for (size_t b = 0; b < nbBytes; b++)
+    {
+        hash ^= (uint64_t)tile.data[b];
+        hash *= FnvPrime;
+    }
+
+    std::stringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec << "_" << tile.cols << "x" << tile.rows;
+    return key.str();
+}
+
+bool ModelCache::load(const std::string& key, const ProbaUtils::Histogram<3>& histogram, ProbaUtils::GMMNDComponents<3>& gmm)
+{
+    Entry entry;
+    bool found = false;
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        if (it != _entries.end())
+        {
+            entry = it->second;
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        found = readEntry(_cachePath + "\\" + key + ".gmm", entry);
+        if (found)
+        {
+            const std::lock_guard<std::mutex> lock(_mutex);
+            _entries.emplace(key, entry);
+        }
+    }
+
+    //Histogram summary guards against hash collisions and stale entries
+    if (!found || entry._nbData != histogram._nbData || entry._nbValues != histogram._values.size())
+        return false;
+
+    gmm = entry._gmm;
+    return true;
+}
+
+void ModelCache::store(const std::string& key, const ProbaUtils::Histogram<3>& histogram, const ProbaUtils::GMMNDComponents<3>& gmm)
+{
+    Entry entry;
+    entry._nbData = histogram._nbData;
+    entry._nbValues = histogram._values.size();
+    entry._gmm = gmm;
+
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _entries[key] = entry;
+
+    if (_writable && createCache())
+    {
+        if (!writeEntry(_cachePath + "\\" + key + ".gmm", entry))
+            Log::Logger::get().log(Log::WARN) << "Impossible to write color model cache entry : " << key;
+    }
+}
+
+bool ModelCache::createCache()
+{
+    //Read-only or denied tiles folders disable writing, errors are not thrown from tile loops
+    std::error_code error;
+    if (!std::filesystem::exists(_cachePath, error) && !error)
+    {
+        if (std::filesystem::create_directory(_cachePath, error))
+            Log::Logger::get().log(Log::TRACE) << _cachePath << " cache folder created.";
+    }
+    if (error || !std::filesystem::is_directory(_cachePath, error))
+    {
+        Log::Logger::get().log(Log::WARN) << "Impossible to create directory : " << _cachePath << (error ? " (" + error.message() + ")" : "") << ", color models will not be cached.";
+        _writable = false;
+    }
+    return _writable;
+}
+
+bool ModelCache::readEntry(const std::string& filePath, Entry& entry) const
+{
+    std::ifstream stream(filePath, std::ios::binary);
+    if (!stream.is_open())
+        return false;
+
+    unsigned int magic = 0, version = 0;
+    if (!SerializationUtils::readValue(stream, magic) || !SerializationUtils::readValue(stream, version) || magic != FileMagic || version != FileVersion)
+        return false;
+    if (!SerializationUtils::readValue(stream, entry._nbData) || !SerializationUtils::readValue(stream, entry._nbValues))
+        return false;
+    if (!SerializationUtils::readGmm<3>(stream, entry._gmm) || entry._gmm.empty())
+        return false;
+
+    return true;
+}
+
+bool ModelCache::writeEntry(const std::string& filePath, const Entry& entry) const
+{
+    //Entry is written to a file of this process and renamed, other processes sharing the folder never read it partially
+    const std::string temporaryPath = filePath + "." + std::to_string(GetCurrentProcessId()) + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream.is_open())
+            return false;
+
+        SerializationUtils::writeValue(stream, FileMagic);
+        SerializationUtils::writeValue(stream, FileVersion);
+        SerializationUtils::writeValue(stream, entry._nbData);
+        SerializationUtils::writeValue(stream, entry._nbValues);
+        SerializationUtils::writeGmm<3>(stream, entry._gmm);
+        stream.close();
+        if (stream.fail())
+        {
+            std::error_code error;
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, filePath, error);
+    if (error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,244 @@
+#include "MosaicBatch.h"
+#include "MatchSolver.h"
+#include "CustomException.h"
+#include "Console.h"
+#include "Log.h"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <set>
+#include <cctype>
+
+
+namespace
+{
+    std::string normalizePath(const std::string& path)
+    {
+        //Windows paths are compared case insensitively
+        std::string normalized = std::filesystem::absolute(path).lexically_normal().string();
+        std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return normalized;
+    }
+}
+
+MosaicBatch::MosaicBatch(const Parameters& parameters)
+{
+    _roi = std::make_shared<FaceDetectionROI>();
+    if (!_roi)
+        throw CustomException("Bad allocation for _roi in MosaicBatch constructor.", CustomException::Level::ERROR);
+    _previewROI = std::make_shared<FaceDetectionROI>();
+    if (!_previewROI)
+        throw CustomException("Bad allocation for _previewROI in MosaicBatch constructor.", CustomException::Level::ERROR);
+
+    std::vector<Parameters> targets;
+    std::vector<int> lines;
+    readManifest(parameters, targets, lines);
+    if (targets.empty())
+        throw CustomException("No target in batch manifest : " + parameters.getBatchPath(), CustomException::Level::NORMAL);
+
+    //Every target is checked before the tile library is scanned
+    std::set<std::string> outputs;
+    for (int t = 0; t < targets.size(); t++)
+    {
+        const Parameters& target = targets[t];
+        Target batchTarget;
+        batchTarget._line = lines[t];
+        batchTarget._name = target.getName();
+        batchTarget._parameters = target;
+
+        std::shared_ptr<TileLibrary> library;
+        if (!target.getRender())
+        {
+            const int reduction = MosaicGenerator::getTileReduction(target);
+            batchTarget._libraryKey = target.getTilesPath() + "|" + std::to_string(reduction);
+            auto it = _libraries.find(batchTarget._libraryKey);
+            if (it == _libraries.end())
+            {
+                Library batchLibrary;
+                batchLibrary._library = std::make_shared<TileLibrary>(target.getTilesPath(), reduction);
+                if (!batchLibrary._library)
+                    throw CustomException("Bad allocation for library in MosaicBatch constructor.", CustomException::Level::ERROR);
+                batchLibrary._preview = target.getPreview();
+                it = _libraries.emplace(batchTarget._libraryKey, batchLibrary).first;
+            }
+            library = it->second._library;
+        }
+
+        try
+        {
+            batchTarget._generator = std::make_shared<MosaicGenerator>(target, library, _roi);
+        }
+        catch (CustomException& e)
+        {
+            throw CustomException("Batch manifest line " + std::to_string(batchTarget._line) + " : " + e.what(), e.getLevel() == CustomException::Level::HELP ? CustomException::Level::NORMAL : e.getLevel());
+        }
+        if (!batchTarget._generator)
+            throw CustomException("Bad allocation for generator in MosaicBatch constructor.", CustomException::Level::ERROR);
+
+        //Targets must not write the same mosaic files or checkpoint
+        const std::string checkpointPath = batchTarget._generator->getOutputCheckpointPath();
+        if (!outputs.insert(normalizePath(batchTarget._generator->getOutputPattern())).second)
+            throw CustomException("Batch manifest line " + std::to_string(batchTarget._line) + " : mosaics of a previous target in the same folder with the same name and format, use a different name", CustomException::Level::NORMAL);
+        if (!checkpointPath.empty() && !outputs.insert(normalizePath(checkpointPath)).second)
+            throw CustomException("Batch manifest line " + std::to_string(batchTarget._line) + " : checkpoint " + checkpointPath + " written by a previous target", CustomException::Level::NORMAL);
+        _targets.push_back(batchTarget);
+    }
+    Log::Logger::get().log(Log::INFO) << "Batch of " << _targets.size() << " targets sharing " << _libraries.size() << " tile libraries";
+}
+
+MosaicBatch::~MosaicBatch()
+{
+    _computedTiles.clear();
+    _targets.clear();
+    _libraries.clear();
+    _roi.reset();
+    _previewROI.reset();
+}
+
+void MosaicBatch::readManifest(const Parameters& parameters, std::vector<Parameters>& targets, std::vector<int>& lines) const
+{
+    std::ifstream stream(parameters.getBatchPath());
+    if (!stream.is_open())
+        throw CustomException("Impossible to open batch manifest : " + parameters.getBatchPath(), CustomException::Level::ERROR);
+
+    //A line is a photo path or a JSON object of target options, other options come from the command line
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+        line = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+
+        try
+        {
+            std::vector<std::string> arguments(1, "Photo_Mosaic_Generator.exe");
+            if (line[0] == '{')
+            {
+                std::vector<JsonUtils::Member> members;
+                if (!JsonUtils::parseObject(line, members))
+                    throw CustomException("Invalid JSON target", CustomException::Level::NORMAL);
+                Parameters::toArguments(members, arguments);
+            }
+            else
+            {
+                arguments.push_back("--photo");
+                arguments.push_back(line);
+            }
+
+            Parameters target = parameters.createTarget(arguments);
+            if (target.getName().empty())
+            {
+                //Mosaics of a batch are named after their photo, or their checkpoint in render mode
+                const std::string source = target.getRender() ? target.getCheckpointPath() : target.getPhotoPath();
+                target = target.createTarget({ "Photo_Mosaic_Generator.exe", "--name", std::filesystem::path(source).stem().string() });
+            }
+            targets.push_back(target);
+            lines.push_back(lineNumber);
+        }
+        catch (CustomException& e)
+        {
+            const std::string message = e.getLevel() == CustomException::Level::HELP ? "Help is not available in batch targets" : e.what();
+            throw CustomException("Batch manifest line " + std::to_string(lineNumber) + " : " + message, CustomException::Level::NORMAL);
+        }
+    }
+}
+
+void MosaicBatch::run()
+{
+    computeTiles();
+
+    std::string failures;
+    int nbFailed = 0;
+    for (int t = 0; t < _targets.size(); t++)
+    {
+        Target& target = _targets[t];
+        Console::Out::get(Console::DEFAULT) << "";
+        Console::Out::get(Console::DEFAULT) << "Target " << t + 1 << "/" << _targets.size() << " : " << target._name;
+        Log::Logger::get().log(Log::INFO) << "Batch target " << t + 1 << "/" << _targets.size() << " : " << target._name << " (line " << target._line << ")";
+
+        //A failed target does not stop the batch, failures are reported at the end
+        std::string error;
+        try
+        {
+            //Preview checkpoints written by previous targets are looked up again
+            const Parameters& parameters = target._parameters;
+            if (t > 0 && !parameters.getRender() && !parameters.getPreview() && !parameters.getCheckpointPath().empty())
+            {
+                std::shared_ptr<TileLibrary> library = _libraries.at(target._libraryKey)._library;
+                target._generator = std::make_shared<MosaicGenerator>(parameters, library, _roi);
+                if (!target._generator)
+                    throw CustomException("Bad allocation for generator in MosaicBatch.", CustomException::Level::ERROR);
+            }
+            target._generator->Build();
+        }
+        catch (CustomException& e)
+        {
+            error = e.getLevel() == CustomException::Level::HELP ? "Help is not available in batch targets" : e.what();
+        }
+        catch (std::exception& e)
+        {
+            error = e.what();
+        }
+        target._generator.reset();
+
+        if (!error.empty())
+        {
+            Console::Out::get(Console::ERROR) << error;
+            Log::Logger::get().log(Log::ERROR) << "Batch target " << target._name << " : " << error;
+            failures += "\n    line " + std::to_string(target._line) + " (" + target._name + ") : " + error;
+            nbFailed++;
+        }
+    }
+    _computedTiles.clear();
+
+    if (nbFailed > 0)
+        throw CustomException(std::to_string(nbFailed) + "/" + std::to_string(_targets.size()) + " batch targets failed :" + failures, CustomException::Level::ERROR);
+}
+
+void MosaicBatch::computeTiles()
+{
+    //Tile sizes of all targets are gathered so that each library image is decoded once
+    bool faceDetection = false;
+    for (auto& target : _targets)
+    {
+        if (target._libraryKey.empty())
+            continue;
+
+        cv::Size tileSize;
+        try
+        {
+            if (!target._generator->computeLibraryTileSize(tileSize))
+                continue;
+        }
+        catch (std::exception& e)
+        {
+            //Reported again when the target is built
+            Log::Logger::get().log(Log::WARN) << "Batch target " << target._name << " left out of shared tiles : " << e.what();
+            continue;
+        }
+
+        Library& library = _libraries.at(target._libraryKey);
+        if (std::find(library._tileSizes.begin(), library._tileSizes.end(), tileSize) == library._tileSizes.end())
+            library._tileSizes.push_back(tileSize);
+        faceDetection = faceDetection || !library._preview;
+    }
+
+    if (faceDetection)
+        _roi->initialize();
+
+    //Required number of tiles does not depend on the grid
+    const int minNbTiles = MatchSolver(std::make_tuple(1, 1)).getRequiredNbTiles();
+    for (auto& [key, library] : _libraries)
+    {
+        if (library._tileSizes.empty())
+            continue;
+
+        Console::Out::get(Console::DEFAULT) << "Computing tiles of " << library._tileSizes.size() << " sizes...";
+        library._library->initialize(minNbTiles);
+        std::vector<std::shared_ptr<const Tiles>> tiles = library._library->compute(library._preview ? *_previewROI : *_roi, library._tileSizes);
+        _computedTiles.insert(_computedTiles.end(), tiles.begin(), tiles.end());
+    }
+}
@@ -1,14 +1,18 @@
 #include "MosaicBuilder.h"
 #include <vector>
+#include <map>
+#include <future>
+#include <omp.h>
 #include "CustomException.h"
 #include "Log.h"
 #include "Console.h"
-#include "ColorEnhancer.h"
+#include "ColorTransfer.h"
 #include "GaussianMixtureModel.h"
+#include "SystemUtils.h"
 
 
-MosaicBuilder::MosaicBuilder(std::tuple<int, int> grid, std::tuple<double, double, double> blending) :
-    _gridWidth(std::get<0>(grid)), _gridHeight(std::get<1>(grid)), _blendingStep(std::get<0>(blending)), _blendingMin(std::get<1>(blending)), _blendingMax(std::get<2>(blending))
+MosaicBuilder::MosaicBuilder(std::tuple<int, int> grid, std::tuple<double, double, double> blending, int quantization, int cellTolerance, ColorTransfer::Engine colorEngine, int quality, MosaicWriter::Format format, const std::string& outputName) :
+    _gridWidth(std::get<0>(grid)), _gridHeight(std::get<1>(grid)), _blendingStep(std::get<0>(blending)), _blendingMin(std::get<1>(blending)), _blendingMax(std::get<2>(blending)), _quantization(quantization), _cellTolerance(cellTolerance), _colorEngine(colorEngine), _quality(quality), _format(format), _outputName(outputName)
 {
 }
 
@@ -16,115 +20,415 @@ MosaicBuilder::~MosaicBuilder()
 {
 }
 
-void MosaicBuilder::build(const Photo& photo, const Tiles& tiles, const MatchSolver& matchSolver)
+void MosaicBuilder::build(const Photo& photo, const Tiles& tiles, const MatchSolver& matchSolver, ModelCache& modelCache, Checkpoint* checkpoint)
 {
     const std::vector<int>& tileIds = matchSolver.getUniqueIds();
     const int gridSize = _gridWidth * _gridHeight;
-    const double blendingSize = _blendingMax - _blendingMin;
-    const int nbSteps = blendingSize > 0 ? (int)(blendingSize / _blendingStep) + 1 : 1;
-    Console::Out::initBar("Building mosaics          ", tileIds.size() + 2 * gridSize + nbSteps);
+    const int nbSteps = computeNbSteps();
+    const ColorTransfer::CostProfile costProfile = ColorTransfer::getCostProfile(_colorEngine);
+    Console::Out::initBar("Building mosaics          ", tileIds.size() + (costProfile._colorModels ? 2 : 1) * gridSize + nbSteps);
     Console::Out::startBar(Console::DEFAULT);
+    Log::Logger::get().log(Log::TRACE) << "Color transfer engine : " << costProfile._name << ", tile cost : " << costProfile._tileCost << ", cell cost : " << costProfile._cellCost;
 
-    //Compute GMMs for all photo tiles
+    //Compute GMMs for all photo tiles, group representatives are fitted first and other cells are warm started from them
     std::vector<ProbaUtils::GMMNDComponents<3>> photoTileGmm(gridSize);
-    #pragma omp parallel for
-    for (int mosaicId = 0; mosaicId < gridSize; mosaicId++)
+    ProbaUtils::GMMSamplerDatas<3> datas;
+    if (costProfile._colorModels)
     {
-        cv::Mat photoTile = photo.getTile(mosaicId);
-        photoTile.convertTo(photoTile, CV_64FC3);
+        std::vector<int> representatives;
+        groupCells(representatives, photo);
+        ProbaUtils::GMMFitStats photoTileStats;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            SystemUtils::ParallelErrors errors;
+            #pragma omp parallel for
+            for (int mosaicId = 0; mosaicId < gridSize; mosaicId++)
+            {
+                const int representative = representatives[mosaicId];
+                if ((pass == 0) != (representative == mosaicId))
+                    continue;
 
-        ProbaUtils::Histogram<3> histogram;
-        ProbaUtils::computeHistogram(histogram, photoTile.ptr<double>(), photoTile.rows * photoTile.cols);
-        GaussianMixtureModel<3>::findOptimalComponents(photoTileGmm[mosaicId], histogram, 1, MaxNbCompo, NbInit, MaxIter, ConvergenceTol, CovarianceReg, true);
-        Console::Out::addBarSteps(1);
+                errors.run([&]()
+                    {
+                        const cv::Mat& photoTile = photo.getTile(mosaicId);
+
+                        ProbaUtils::Histogram<3> histogram;
+                        ProbaUtils::computeHistogram(histogram, photoTile.data, photoTile.rows * photoTile.cols);
+                        ProbaUtils::GMMFitStats stats;
+                        ColorModel warmStartedGmm(histogram, NbInit, MaxIter, ConvergenceTol, CovarianceReg, true);
+                        if (representative != mosaicId && warmStartedGmm.refine(photoTileGmm[representative], MaxIter, stats))
+                            photoTileGmm[mosaicId] = warmStartedGmm.getComponents();
+                        else
+                            computeGmm(photoTileGmm[mosaicId], histogram, 1, stats);
+                        #pragma omp critical(ModelStats)
+                        photoTileStats += stats;
+                        Console::Out::addBarSteps(1);
+                    });
+            }
+            errors.rethrow();
+        }
+        logModelStats("Photo tile models", photoTileStats);
+
+        ProbaUtils::generateGMMSamplerDatas<3>(datas, ColorEnhancerNbSobolSamples, ProbaUtils::SOBOL, true);
     }
 
-    //Compute GMMs for all unique tiles
-    std::map<int, TileData> tilesData;
-    for (int tileId: tileIds)
+    //Cells refer to unique tiles by their index in tile data
+    std::map<int, int> tileIndices;
+    for (int t = 0; t < tileIds.size(); t++)
+        tileIndices.emplace(tileIds[t], t);
+
+    std::vector<int> cellTiles(gridSize);
+    for (int mosaicId = 0; mosaicId < gridSize; mosaicId++)
     {
-        tilesData.emplace(tileId, TileData());
+        int tileId = matchSolver.getMatchingId(mosaicId);
+        if (tileId < 0)
+            throw CustomException("One or several tiles missing from match solver !", CustomException::Level::ERROR);
+        cellTiles[mosaicId] = tileIndices[tileId];
     }
 
+    //Compute GMMs and color transfer source data for all unique tiles
+    const cv::Size tileSize = photo.getTileSize();
+    std::vector<TileData> tilesData(tileIds.size());
+    ProbaUtils::GMMFitStats tileStats;
+    SystemUtils::ParallelErrors errors;
     #pragma omp parallel for
     for (int t = 0; t < tileIds.size(); t++)
     {
-        auto& tileData = tilesData[tileIds[t]];
-        const std::string tilePath = tiles.getTileFilepath(tileIds[t]);
+        errors.run([&]()
+            {
+                TileData& tileData = tilesData[t];
+                ProbaUtils::GMMFitStats stats;
+                computeTileData(tileData, tiles.getTileFilepath(tileIds[t]), modelCache, costProfile._colorModels, stats);
+                #pragma omp critical(ModelStats)
+                tileStats += stats;
+                tileData._transferSource = ColorTransfer::createSource(_colorEngine, tileData._histogram, tileData._gmm, datas, tileSize);
+                Console::Out::addBarSteps(1);
+            });
+    }
+    errors.rethrow();
+    if (costProfile._colorModels)
+        logModelStats("Tile models", tileStats);
 
-        cv::Mat tile = cv::imread(tilePath);
-        if (tile.empty())
-            throw CustomException("Impossible to find temporary exported tile : " + tilePath, CustomException::Level::ERROR);
-        tile.convertTo(tile, CV_64FC3);
+    std::vector<ColorTransfer::Model> models(checkpoint ? gridSize : 0);
+    renderMosaics(photo, cellTiles, tilesData, photoTileGmm, datas, models, false);
 
-        ProbaUtils::computeHistogram(tileData._histogram, tile.ptr<double>(), tile.rows * tile.cols);
-        GaussianMixtureModel<3>::findOptimalComponents(tileData._gmm, tileData._histogram, MaxNbCompo, MaxNbCompo, NbInit, MaxIter, ConvergenceTol, CovarianceReg, true);
-        Console::Out::addBarSteps(1);
+    if (checkpoint)
+    {
+        std::vector<Checkpoint::TileReference>& tileReferences = checkpoint->getTiles();
+        tileReferences.resize(tileIds.size());
+        for (int t = 0; t < tileIds.size(); t++)
+        {
+            tiles.getTileReference(tileIds[t], tileReferences[t]._imagePath, tileReferences[t]._box);
+            tileReferences[t]._gmm = tilesData[t]._gmm;
+        }
+
+        std::vector<Checkpoint::Cell>& cells = checkpoint->getCells();
+        cells.resize(gridSize);
+        for (int mosaicId = 0; mosaicId < gridSize; mosaicId++)
+            cells[mosaicId] = {cellTiles[mosaicId], std::move(models[mosaicId])};
     }
 
-    //Compute color enhancer data for all tile / photo tile pairs and apply color transformation with blending
-    const cv::Size tileSize = photo.getTileSize();
-    cv::Size mosaicSize = tileSize;
-    mosaicSize.width *= _gridWidth;
-    mosaicSize.height *= _gridHeight;
-    std::vector<cv::Mat> mosaics;
-    mosaics.reserve(nbSteps);
-    for (int s = 0; s < nbSteps; s++)
-        mosaics.emplace_back(mosaicSize, CV_8UC3, cv::Scalar(0, 0, 0));
+    Console::Out::waitBar();
+    Log::Logger::get().log(Log::TRACE) << "Mosaic computed.";
+}
 
-    ProbaUtils::GMMSamplerDatas<3> datas;
-    ProbaUtils::generateGMMSamplerDatas<3>(datas, ColorEnhancerNbSamples, true);
+void MosaicBuilder::render(const Photo& photo, Checkpoint& checkpoint)
+{
+    std::vector<Checkpoint::TileReference>& tileReferences = checkpoint.getTiles();
+    std::vector<Checkpoint::Cell>& cells = checkpoint.getCells();
+    const int nbTiles = tileReferences.size();
+    const int gridSize = _gridWidth * _gridHeight;
+    Console::Out::initBar("Rendering mosaics         ", nbTiles + gridSize + computeNbSteps());
+    Console::Out::startBar(Console::DEFAULT);
 
+    //Tiles are resampled again from their source images, stored color models replace fitting and sampling
+    const cv::Size tileSize = photo.getTileSize();
+    const ProbaUtils::GMMSamplerDatas<3> datas;
+    std::vector<TileData> tilesData(nbTiles);
+    SystemUtils::ParallelErrors errors;
     #pragma omp parallel for
+    for (int t = 0; t < nbTiles; t++)
+    {
+        errors.run([&]()
+            {
+                cv::Mat tile;
+                Tiles::computeTile(tile, tileReferences[t]._imagePath, tileReferences[t]._box, tileSize, checkpoint.getTileReduction());
+                TileData& tileData = tilesData[t];
+                ProbaUtils::computeHistogram(tileData._histogram, tile.data, tile.rows * tile.cols);
+                tileData._gmm = tileReferences[t]._gmm;
+                tileData._transferSource = ColorTransfer::createSource(_colorEngine, tileData._histogram, tileData._gmm, datas, tileSize);
+                Console::Out::addBarSteps(1);
+            });
+    }
+    errors.rethrow();
+
+    std::vector<int> cellTiles(gridSize);
+    std::vector<ColorTransfer::Model> models(gridSize);
     for (int mosaicId = 0; mosaicId < gridSize; mosaicId++)
     {
-        int tileId = matchSolver.getMatchingId(mosaicId);
-        if (tileId < 0)
-            throw CustomException("One or several tiles missing from match solver !", CustomException::Level::ERROR);
+        cellTiles[mosaicId] = cells[mosaicId]._tile;
+        models[mosaicId] = cells[mosaicId]._model;
+    }
+
+    const std::vector<ProbaUtils::GMMNDComponents<3>> photoTileGmm(gridSize);
+    renderMosaics(photo, cellTiles, tilesData, photoTileGmm, datas, models, true);
+
+    Console::Out::waitBar();
+    Log::Logger::get().log(Log::TRACE) << "Mosaic rendered from checkpoint.";
+}
 
-        auto& tileData = tilesData[tileId];
-        ColorEnhancer enhancer(tileData._histogram, tileData._gmm, photoTileGmm[mosaicId], datas);
+void MosaicBuilder::renderMosaics(const Photo& photo, const std::vector<int>& cellTiles, const std::vector<TileData>& tilesData, const std::vector<ProbaUtils::GMMNDComponents<3>>& photoTileGmm, const ProbaUtils::GMMSamplerDatas<3>& datas, std::vector<ColorTransfer::Model>& models, bool restoreModels)
+{
+    //Compute color transfer data for all tile / photo tile pairs and apply color transformation with blending
+    //Grid rows are rendered in order and streamed to one writer per blending step, a row band is encoded while the next one is rendered
+    const int nbSteps = computeNbSteps();
+    const cv::Size tileSize = photo.getTileSize();
+    const cv::Size mosaicSize(tileSize.width * _gridWidth, tileSize.height * _gridHeight);
+    std::vector<std::unique_ptr<MosaicWriter>> writers;
+    std::vector<std::string> mosaicPaths;
+    std::vector<cv::Mat> bands[2];
+    for (int s = 0; s < nbSteps; s++)
+    {
+        mosaicPaths.push_back(computeMosaicPath(photo.getDirectory(), _blendingMin + s * _blendingStep));
+        writers.push_back(MosaicWriter::create(_format, mosaicPaths.back(), mosaicSize, _quality));
+        for (auto& stepBands : bands)
+            stepBands.emplace_back(tileSize.height, mosaicSize.width, CV_8UC3);
+    }
+
+    std::future<void> encoding;
+    const int nbThreads = omp_get_max_threads();
+    for (int row = 0; row < _gridHeight; row++)
+    {
+        std::vector<cv::Mat>& rowBands = bands[row % 2];
 
-        for (int s = 0; s < nbSteps; s++)
+        SystemUtils::ParallelErrors errors;
+        #pragma omp parallel for
+        for (int column = 0; column < _gridWidth; column++)
         {
-            double blending = _blendingMin + s * _blendingStep;
-            cv::Mat enhancedTile(tileSize, CV_64FC3);
-            enhancer.apply(enhancedTile, blending);
-            copyTileOnMosaic(mosaics[s], enhancedTile, mosaicId, photo.getTileBox(mosaicId));
+            errors.run([&]()
+                {
+                    const int mosaicId = row * _gridWidth + column;
+                    const TileData& tileData = tilesData[cellTiles[mosaicId]];
+                    const ColorTransfer::Model* model = restoreModels ? &models[mosaicId] : nullptr;
+                    std::unique_ptr<ColorTransfer> transfer = ColorTransfer::create(_colorEngine, *tileData._transferSource, photo.getTile(mosaicId), photoTileGmm[mosaicId], datas, model);
+                    if (!restoreModels && !models.empty())
+                        models[mosaicId] = transfer->getModel();
+
+                    cv::Mat enhancedTile(tileSize, CV_8UC3);
+                    for (int s = 0; s < nbSteps; s++)
+                    {
+                        double blending = _blendingMin + s * _blendingStep;
+                        transfer->apply(enhancedTile, blending);
+                        copyTileOnBand(rowBands[s], enhancedTile, column * tileSize.width);
+                    }
+                    Console::Out::addBarSteps(1);
+                });
         }
+
+        //Pending encoding is waited for before any rethrow, it refers to the bands
+        if (encoding.valid())
+            encoding.get();
+        errors.rethrow();
+        encoding = std::async(std::launch::async, [&writers, &rowBands, nbThreads]()
+            {
+                omp_set_num_threads(nbThreads); //Encoding thread keeps the caller OpenMP thread limit
+                for (int s = 0; s < (int)writers.size(); s++)
+                    writers[s]->write(rowBands[s]);
+            });
+    }
+    if (encoding.valid())
+        encoding.get();
+
+    for (int s = 0; s < nbSteps; s++)
+    {
+        writers[s]->finish();
+        Log::Logger::get().log(Log::INFO) << "Mosaic exported at " << mosaicPaths[s];
         Console::Out::addBarSteps(1);
     }
-    
+}
+
+void MosaicBuilder::precompute(const Tiles& tiles, ModelCache& modelCache, int nbThreads)
+{
+    //Runs in background while mosaics are built, progress bar belongs to the build
+    const int nbTiles = tiles.getNbTiles();
+    int nbFitted = 0;
+    ProbaUtils::GMMFitStats precomputeStats;
+    SystemUtils::ParallelErrors errors;
+    #pragma omp parallel for num_threads(nbThreads) reduction(+:nbFitted)
+    for (int t = 0; t < nbTiles; t++)
+    {
+        errors.run([&]()
+            {
+                TileData tileData;
+                ProbaUtils::GMMFitStats stats;
+                if (computeTileData(tileData, tiles.getTileFilepath(t), modelCache, true, stats))
+                    nbFitted++;
+                #pragma omp critical(ModelStats)
+                precomputeStats += stats;
+            });
+    }
+    errors.rethrow();
+
+    Log::Logger::get().log(Log::INFO) << "Tile models precomputed : " << nbFitted << " fitted, " << nbTiles - nbFitted << " already cached.";
+    logModelStats("Precomputed tile models", precomputeStats);
+}
+
+bool MosaicBuilder::computeTileData(TileData& tileData, const std::string& tilePath, ModelCache& modelCache, bool colorModel, ProbaUtils::GMMFitStats& stats)
+{
+    cv::Mat tile = cv::imread(tilePath);
+    if (tile.empty())
+        throw CustomException("Impossible to find temporary exported tile : " + tilePath, CustomException::Level::ERROR);
+    std::string key = ModelCache::computeKey(tile);
+    if (_quantization > 0)
+        key += "_q" + std::to_string(_quantization);
+
+    ProbaUtils::computeHistogram(tileData._histogram, tile.data, tile.rows * tile.cols);
+    if (colorModel && !modelCache.load(key, tileData._histogram, tileData._gmm))
+    {
+        computeGmm(tileData._gmm, tileData._histogram, MaxNbCompo, stats);
+        modelCache.store(key, tileData._histogram, tileData._gmm);
+        return true;
+    }
+    return false;
+}
+
+void MosaicBuilder::computeGmm(ProbaUtils::GMMNDComponents<3>& gmm, const ProbaUtils::Histogram<3>& histogram, int minNbComponents, ProbaUtils::GMMFitStats& stats) const
+{
+    if (_quantization > 0 && histogram._values.size() > CoresetMinValues)
+    {
+        //Fit on weighted coreset, then refine on full data
+        ProbaUtils::Histogram<3> coreset;
+        ProbaUtils::computeQuantizedHistogram(coreset, histogram, _quantization);
+
+        ProbaUtils::GMMNDComponents<3> coresetGmm;
+        ColorModel::findOptimalComponents(coresetGmm, coreset, minNbComponents, MaxNbCompo, NbInit, MaxIter, ConvergenceTol, CovarianceReg, true, stats, BICPatience);
+
+        ColorModel refinedGmm(histogram, NbInit, MaxIter, ConvergenceTol, CovarianceReg, true);
+        if (!coresetGmm.empty() && refinedGmm.refine(coresetGmm, CoresetRefineIter, stats))
+        {
+            gmm = refinedGmm.getComponents();
+
+            //Exact fit is only computed for the report, when debug logs are enabled
+            if (!Log::Logger::get().isEnabled(Log::DEBUG))
+                return;
+            ProbaUtils::GMMNDComponents<3> exactGmm;
+            ColorModel exactModel(histogram, NbInit, MaxIter, ConvergenceTol, CovarianceReg, true);
+            ProbaUtils::GMMFitStats exactStats; //Report only fit is kept out of the phase stats
+            ColorModel::findOptimalComponents(exactGmm, histogram, minNbComponents, MaxNbCompo, NbInit, MaxIter, ConvergenceTol, CovarianceReg, true, exactStats, BICPatience);
+            if (exactModel.refine(exactGmm, 0, exactStats))
+            {
+                const double BICDiff = refinedGmm.getBIC() - exactModel.getBIC();
+                Log::Logger::get().log(Log::DEBUG) << "Coreset fit : " << coreset._values.size() << "/" << histogram._values.size() << " values, BIC difference with exact fit " << BICDiff << " (" << 100. * BICDiff / std::abs(exactModel.getBIC()) << "%)";
+            }
+            return;
+        }
+    }
+
+    ColorModel::findOptimalComponents(gmm, histogram, minNbComponents, MaxNbCompo, NbInit, MaxIter, ConvergenceTol, CovarianceReg, true, stats, BICPatience);
+}
+
+void MosaicBuilder::logModelStats(const std::string& phase, const ProbaUtils::GMMFitStats& stats) const
+{
+    const long long nbTotalDistances = stats._kmeansDistances + stats._kmeansSkippedDistances;
+    Log::Logger::get().log(Log::TRACE) << phase << " kmeans : " << stats._kmeansDistances << " distances computed, " << stats._kmeansSkippedDistances << " skipped (" << (nbTotalDistances > 0 ? 100. * stats._kmeansSkippedDistances / nbTotalDistances : 0.) << "%)";
+    Log::Logger::get().log(Log::TRACE) << phase << " EM : " << stats._EMFits << " fits, " << (stats._EMFits > 0 ? (double)stats._EMIterations / stats._EMFits : 0.) << " iterations per fit, " << stats._EMCappedFits << " stopped by iteration limit";
+}
+
+void MosaicBuilder::groupCells(std::vector<int>& representatives, const Photo& photo) const
+{
+    const int gridSize = _gridWidth * _gridHeight;
+    representatives.resize(gridSize);
+    for (int mosaicId = 0; mosaicId < gridSize; mosaicId++)
+        representatives[mosaicId] = mosaicId;
+    if (_cellTolerance <= 0)
+        return;
+
+    std::vector<std::vector<int>> signatures(gridSize);
+    SystemUtils::ParallelErrors errors;
     #pragma omp parallel for
-    for (int s = 0; s < nbSteps; s++) 
+    for (int mosaicId = 0; mosaicId < gridSize; mosaicId++)
+        errors.run([&]() { computeCellSignature(signatures[mosaicId], photo.getTile(mosaicId)); });
+    errors.rethrow();
+
+    //First cell in grid order is the group representative, grouping does not depend on thread scheduling
+    std::map<std::vector<int>, int> groups;
+    int nbGroupedCells = 0;
+    for (int mosaicId = 0; mosaicId < gridSize; mosaicId++)
     {
-        double blending = _blendingMin + s * _blendingStep;
-        exportMosaic(photo.getDirectory(), blending, mosaics[s]);
-        Console::Out::addBarSteps(1);
+        auto group = groups.emplace(signatures[mosaicId], mosaicId);
+        if (!group.second)
+        {
+            representatives[mosaicId] = group.first->second;
+            nbGroupedCells++;
+        }
     }
 
-    Console::Out::waitBar();
-    Log::Logger::get().log(Log::TRACE) << "Mosaic computed.";
+    Log::Logger::get().log(Log::TRACE) << "Photo cells grouping : " << groups.size() << " groups, " << nbGroupedCells << "/" << gridSize << " cells warm started (" << 100. * nbGroupedCells / gridSize << "% hit rate)";
+}
+
+void MosaicBuilder::computeCellSignature(std::vector<int>& signature, const cv::Mat& cell) const
+{
+    constexpr int NbFingerprintBins = FingerprintBins * FingerprintBins * FingerprintBins;
+    const int channels = cell.channels();
+    const int nbPixels = cell.rows * cell.cols;
+    signature.assign(channels * SignatureBlocks * SignatureBlocks + NbFingerprintBins, 0);
+
+    //Block means quantized with cell tolerance
+    int s = 0;
+    for (int by = 0; by < SignatureBlocks; by++)
+    {
+        const int rowMin = by * cell.rows / SignatureBlocks;
+        const int rowMax = std::max((by + 1) * cell.rows / SignatureBlocks, rowMin + 1);
+        for (int bx = 0; bx < SignatureBlocks; bx++, s += channels)
+        {
+            const int colMin = bx * cell.cols / SignatureBlocks;
+            const int colMax = std::max((bx + 1) * cell.cols / SignatureBlocks, colMin + 1);
+            double sums[4] = {0, 0, 0, 0};
+            for (int i = rowMin; i < rowMax; i++)
+                for (int j = colMin; j < colMax; j++)
+                    for (int c = 0; c < channels; c++)
+                        sums[c] += cell.data[channels * (i * cell.cols + j) + c];
+
+            const double nbBlockPixels = (double)(rowMax - rowMin) * (colMax - colMin);
+            for (int c = 0; c < channels; c++)
+                signature[s + c] = (int)(sums[c] / nbBlockPixels / _cellTolerance);
+        }
+    }
+
+    //Coarse color histogram fingerprint, bin proportions are quantized
+    std::vector<int> bins(NbFingerprintBins, 0);
+    for (int p = 0; p < nbPixels; p++)
+    {
+        int bin = 0;
+        for (int c = 0; c < 3; c++)
+            bin = bin * FingerprintBins + cell.data[channels * p + c] * FingerprintBins / 256;
+        bins[bin]++;
+    }
+    for (int b = 0; b < NbFingerprintBins; b++)
+        signature[s + b] = (int)std::lround((double)FingerprintLevels * bins[b] / nbPixels);
 }
 
-void MosaicBuilder::copyTileOnMosaic(cv::Mat& mosaic, const cv::Mat& tile, int mosaicId, const cv::Rect& box)
+int MosaicBuilder::computeNbSteps() const
 {
-    const int channels = tile.channels();
-    int pt = 0;
-    const int step = 3 * (mosaic.cols - box.width);
-    int pm = channels * (box.y * mosaic.cols + box.x);
-    for (int i = 0; i < tile.rows; i++, pm += step)
-        for (int j = 0; j < tile.cols; j++)
-            for (int c = 0; c < channels; c++, pt++, pm++)
-                mosaic.data[pm] = (uchar)tile.data[pt];
+    const double blendingSize = _blendingMax - _blendingMin;
+    return blendingSize > 0 ? (int)(blendingSize / _blendingStep) + 1 : 1;
 }
 
-void MosaicBuilder::exportMosaic(const std::string& path, double blending, const cv::Mat mosaic)
+void MosaicBuilder::copyTileOnBand(cv::Mat& band, const cv::Mat& tile, int column)
+{
+    const int rowSize = 3 * tile.cols;
+    for (int i = 0; i < tile.rows; i++)
+        std::copy(tile.ptr(i), tile.ptr(i) + rowSize, band.ptr(i) + 3 * column);
+}
+
+std::string MosaicBuilder::computeMosaicPath(const std::string& path, double blending) const
 {
     std::string value = std::to_string((int)(blending * 100));
     value = std::string(3 - value.length(), '0') + value;
-    std::string mosaicPath = (path.empty() ? "" : path + "\\") + "mosaic_" + value + ".jpg";
-    cv::imwrite(mosaicPath, mosaic, std::vector<int>({MosaicParam[0], MosaicParam[1]}));
-    Log::Logger::get().log(Log::INFO) << "Mosaic exported at " << mosaicPath;
+    return (path.empty() ? "" : path + "\\") + _outputName + "_" + value + "." + MosaicWriter::getExtension(_format);
 }
 
+std::string MosaicBuilder::computeMosaicPattern(const std::string& path) const
+{
+    return (path.empty() ? "" : path + "\\") + _outputName + "_*." + MosaicWriter::getExtension(_format);
+}
\ No newline at end of file
@@ -1,53 +1,203 @@
 #include "MosaicGenerator.h"
 #include "CustomException.h"
 #include "Console.h"
+#include "Log.h"
+#include <filesystem>
+#include <future>
+#include <algorithm>
+#include <omp.h>
 
 
-MosaicGenerator::MosaicGenerator(const Parameters& parameters)
+const std::string MosaicGenerator::CheckpointExtension = ".pmck";
+
+MosaicGenerator::MosaicGenerator(const Parameters& parameters, std::shared_ptr<TileLibrary> library, std::shared_ptr<FaceDetectionROI> roi) :
+    _precompute(parameters.getPrecompute()), _render(parameters.getRender()), _preview(parameters.getPreview()), _checkpointPath(parameters.getCheckpointPath())
 {
-    _photo = std::make_shared<Photo>(parameters.getPhotoPath(), parameters.getGrid(), parameters.getScale(), parameters.getResolution());
+    if (_render)
+    {
+        //Only photo cells are computed again, matching and color models come from checkpoint
+        _checkpoint = std::make_shared<Checkpoint>(_checkpointPath);
+        if (!_checkpoint)
+            throw CustomException("Bad allocation for _checkpoint in MosaicGenerator constructor.", CustomException::Level::ERROR);
+
+        _photo = std::make_shared<Photo>(_checkpoint->getPhotoPath(), _checkpoint->getGrid(), _checkpoint->getScale(), _checkpoint->getResolution(), _checkpoint->getPreview() ? PreviewTileSize : 0);
+        if (!_photo)
+            throw CustomException("Bad allocation for _photo in MosaicGenerator constructor.", CustomException::Level::ERROR);
+
+        _mosaicBuilder = std::make_shared<MosaicBuilder>(_checkpoint->getGrid(), parameters.getBlending(), parameters.getQuantization(), parameters.getCellTolerance(), _checkpoint->getColorEngine(), parameters.getQuality(), parameters.getFormat(), computeOutputName(parameters, _checkpoint->getPreview()));
+        if (!_mosaicBuilder)
+            throw CustomException("Bad allocation for _mosaicBuilder in MosaicGenerator constructor.", CustomException::Level::ERROR);
+        return;
+    }
+
+    //Preview cells and tiles are small, tiles are decoded reduced and cropped without face detection
+    _photo = std::make_shared<Photo>(parameters.getPhotoPath(), parameters.getGrid(), parameters.getScale(), parameters.getResolution(), _preview ? PreviewTileSize : 0);
     if (!_photo)
         throw CustomException("Bad allocation for _photo in MosaicGenerator constructor.", CustomException::Level::ERROR);
 
-    _roi = std::make_shared<FaceDetectionROI>();
+    //Resident library and detectors are given in server mode
+    _roi = (roi && !_preview) ? roi : std::make_shared<FaceDetectionROI>();
     if (!_roi)
         throw CustomException("Bad allocation for _roi in MosaicGenerator constructor.", CustomException::Level::ERROR);
 
-    _tiles = std::make_shared<Tiles>(parameters.getTilesPath(), parameters.getGrid());
-    if (!_tiles)
-        throw CustomException("Bad allocation for _tiles in MosaicGenerator constructor.", CustomException::Level::ERROR);
-
-    _duplicateRemover = std::make_shared<DuplicateRemover>();
-    if (!_duplicateRemover)
-        throw CustomException("Bad allocation for _duplicateRemover in MosaicGenerator constructor.", CustomException::Level::ERROR);
+    _library = library ? library : std::make_shared<TileLibrary>(parameters.getTilesPath(), getTileReduction(parameters));
+    if (!_library)
+        throw CustomException("Bad allocation for _library in MosaicGenerator constructor.", CustomException::Level::ERROR);
 
     _matchSolver = std::make_shared<MatchSolver>(parameters.getGrid());
     if (!_matchSolver)
         throw CustomException("Bad allocation for _matchSolver in MosaicGenerator constructor.", CustomException::Level::ERROR);
 
-    _mosaicBuilder = std::make_shared<MosaicBuilder>(parameters.getGrid(), parameters.getBlending());
+    const ColorTransfer::Engine colorEngine = _preview ? PreviewColorEngine : parameters.getColorEngine();
+    const std::string outputName = computeOutputName(parameters, _preview);
+    _mosaicBuilder = std::make_shared<MosaicBuilder>(parameters.getGrid(), parameters.getBlending(), parameters.getQuantization(), parameters.getCellTolerance(), colorEngine, parameters.getQuality(), parameters.getFormat(), outputName);
     if (!_mosaicBuilder)
         throw CustomException("Bad allocation for _mosaicBuilder in MosaicGenerator constructor.", CustomException::Level::ERROR);
+
+    if (_preview && _checkpointPath.empty())
+        _checkpointPath = (_photo->getDirectory().empty() ? "" : _photo->getDirectory() + "\\") + outputName + CheckpointExtension;
+    if (!_preview && !_checkpointPath.empty())
+        findPreviewCheckpoint(parameters);
+
+    if (!_checkpointPath.empty())
+    {
+        _checkpoint = std::make_shared<Checkpoint>(parameters.getPhotoPath(), parameters.getGrid(), parameters.getScale(), parameters.getResolution(), colorEngine, _preview, getTileReduction(parameters));
+        if (!_checkpoint)
+            throw CustomException("Bad allocation for _checkpoint in MosaicGenerator constructor.", CustomException::Level::ERROR);
+    }
 }
 
 MosaicGenerator::~MosaicGenerator()
 {
     _photo.reset();
     _roi.reset();
+    _library.reset();
     _tiles.reset();
     _matchSolver.reset();
     _mosaicBuilder.reset();
+    _checkpoint.reset();
+    _previewCheckpoint.reset();
+}
+
+int MosaicGenerator::getTileReduction(const Parameters& parameters)
+{
+    return parameters.getPreview() ? PreviewTileReduction : 1;
+}
+
+std::string MosaicGenerator::computeOutputName(const Parameters& parameters, bool preview)
+{
+    const std::string name = parameters.getName();
+    return (name.empty() ? "" : name + "_") + (preview ? "preview" : "mosaic");
+}
+
+bool MosaicGenerator::computeLibraryTileSize(cv::Size& tileSize) const
+{
+    //Render and preview upgrade do not compute tiles of the whole library
+    if (_render || _previewCheckpoint)
+        return false;
+
+    tileSize = _photo->computeTileSize();
+    return true;
+}
+
+std::string MosaicGenerator::getOutputPattern() const
+{
+    return _mosaicBuilder->computeMosaicPattern(_photo->getDirectory());
+}
+
+std::string MosaicGenerator::getOutputCheckpointPath() const
+{
+    //Render mode only reads its checkpoint
+    return _render ? "" : _checkpointPath;
 }
 
 void MosaicGenerator::Build()
 {
     Console::Out::get(Console::DEFAULT) << "Initializing data...";
     _photo->initialize();
-    _roi->initialize();
-    _tiles->initialize(_matchSolver->getRequiredNbTiles());
+    if (_render)
+    {
+        _mosaicBuilder->render(*_photo, *_checkpoint);
+        return;
+    }
+
+    if (!_preview)
+        _roi->initialize();
+
+    if (_previewCheckpoint)
+    {
+        //Only tiles matched by the preview are computed again at full resolution
+        std::vector<std::string> imagePaths;
+        for (const auto& tile : _previewCheckpoint->getTiles())
+            imagePaths.push_back(tile._imagePath);
+        std::vector<int> matchingIds;
+        for (const auto& cell : _previewCheckpoint->getCells())
+            matchingIds.push_back(cell._tile);
+
+        _tiles = _library->compute(*_roi, _photo->getTileSize(), imagePaths);
+        _matchSolver->restore(matchingIds);
+    }
+    else
+    {
+        _library->initialize(_matchSolver->getRequiredNbTiles());
+        _tiles = _library->compute(*_roi, _photo->getTileSize());
+    }
+
+    //Library tile models are fitted in background from the end of ingestion, tiles fitted first by either side are loaded from the cache by the other
+    std::future<void> precomputing;
+    if (_precompute)
+    {
+        const int nbThreads = std::max(1, omp_get_max_threads() / PrecomputeThreadsDivisor);
+        std::shared_ptr<const Tiles> tiles = _tiles;
+        std::shared_ptr<TileLibrary> library = _library;
+        std::shared_ptr<MosaicBuilder> mosaicBuilder = _mosaicBuilder;
+        precomputing = std::async(std::launch::async, [tiles, library, mosaicBuilder, nbThreads]()
+            {
+                mosaicBuilder->precompute(*tiles, library->getModelCache(), nbThreads);
+            });
+        Log::Logger::get().log(Log::TRACE) << "Tile models precomputing started on " << nbThreads << " threads.";
+    }
+
+    if (!_previewCheckpoint)
+        _matchSolver->solve(*_tiles, *_photo);
+    _mosaicBuilder->build(*_photo, *_tiles, *_matchSolver, _library->getModelCache(), _checkpoint.get());
+    if (_checkpoint)
+        _checkpoint->save(_checkpointPath);
+
+    if (precomputing.valid())
+    {
+        Console::Out::get(Console::DEFAULT) << "Waiting for tile models precomputing...";
+        precomputing.get();
+    }
+}
+
+void MosaicGenerator::findPreviewCheckpoint(const Parameters& parameters)
+{
+    if (!std::filesystem::exists(_checkpointPath))
+        return;
+
+    //Unreadable, outdated or truncated checkpoints are not previews to reuse, this run overwrites them
+    std::shared_ptr<Checkpoint> checkpoint;
+    try
+    {
+        checkpoint = std::make_shared<Checkpoint>(_checkpointPath);
+    }
+    catch (std::exception& e)
+    {
+        Log::Logger::get().log(Log::WARN) << "Checkpoint " << _checkpointPath << " ignored : " << e.what();
+        return;
+    }
+    if (!checkpoint)
+        throw CustomException("Bad allocation for checkpoint in MosaicGenerator.", CustomException::Level::ERROR);
+
+    if (!checkpoint->getPreview())
+        return;
+    if (checkpoint->getPhotoPath() != parameters.getPhotoPath() || checkpoint->getGrid() != parameters.getGrid())
+    {
+        Log::Logger::get().log(Log::INFO) << "Preview checkpoint " << _checkpointPath << " not reused, photo or grid differs.";
+        return;
+    }
 
-    _duplicateRemover->run(*_tiles);
-    _tiles->compute(*_roi, *_photo);
-    _matchSolver->solve(*_tiles);
-    _mosaicBuilder->build(*_photo, *_tiles, *_matchSolver);
+    _previewCheckpoint = checkpoint;
+    Log::Logger::get().log(Log::INFO) << "Tiles matching reused from preview checkpoint " << _checkpointPath;
 }
@@ -0,0 +1,253 @@
+#include "MosaicServer.h"
+#include "MosaicGenerator.h"
+#include "MatchSolver.h"
+#include "CustomException.h"
+#include "Console.h"
+#include "Log.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <algorithm>
+#include <omp.h>
+
+
+namespace
+{
+    double elapsedSeconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+    {
+        return std::chrono::duration<double>(end - start).count();
+    }
+}
+
+MosaicServer::MosaicServer(const Parameters& parameters) :
+    _nbWorkers(parameters.getNbJobs()), _nbWorkerThreads(std::max(1, omp_get_max_threads() / parameters.getNbJobs())), _tilesPath(parameters.getTilesPath()), _nbQueued(0), _nbRunning(0), _nbReceived(0), _closed(false)
+{
+    //Standard output only carries protocol messages
+    Console::Out::setSilent(true);
+}
+
+MosaicServer::~MosaicServer()
+{
+    _libraries.clear();
+    _rois.clear();
+    Console::Out::setSilent(false);
+}
+
+void MosaicServer::run()
+{
+    initialize();
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < _nbWorkers; w++)
+        workers.emplace_back(&MosaicServer::runWorker, this, w);
+
+    std::stringstream ready;
+    ready << "{\"status\":\"ready\",\"workers\":" << _nbWorkers << "}";
+    report(ready.str());
+
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        Job job;
+        std::string error;
+        if (parseJob(line, job, error))
+            pushJob(job);
+        else
+            report("{\"status\":\"error\",\"message\":" + JsonUtils::escape(error) + "}");
+    }
+
+    //End of input, queued jobs are finished before exit
+    {
+        const std::lock_guard<std::mutex> lock(_queueMutex);
+        _closed = true;
+    }
+    _queueCondition.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+    Log::Logger::get().log(Log::INFO) << "Server stopped after " << _nbReceived << " jobs.";
+}
+
+void MosaicServer::initialize()
+{
+    //Face detectors are loaded once per worker, a tile library can be scanned before the first job
+    _rois.resize(_nbWorkers);
+    for (auto& roi : _rois)
+    {
+        roi = std::make_shared<FaceDetectionROI>();
+        if (!roi)
+            throw CustomException("Bad allocation for roi in MosaicServer.", CustomException::Level::ERROR);
+        roi->initialize();
+    }
+
+    if (!_tilesPath.empty())
+    {
+        MatchSolver matchSolver(std::make_tuple(1, 1));
+        getLibrary(_tilesPath, 1)->initialize(matchSolver.getRequiredNbTiles());
+    }
+    Log::Logger::get().log(Log::INFO) << "Server ready with " << _nbWorkers << " workers, " << _nbWorkerThreads << " threads per worker.";
+}
+
+bool MosaicServer::parseJob(const std::string& line, Job& job, std::string& error)
+{
+    std::vector<JsonUtils::Member> members;
+    if (!JsonUtils::parseObject(line, members))
+    {
+        error = "Invalid JSON job : " + line;
+        return false;
+    }
+
+    std::vector<JsonUtils::Member> options;
+    for (const auto& member : members)
+    {
+        if (member._key == "id")
+            job._id = member._value;
+        else if (member._key == "user")
+            job._user = member._value;
+        else
+            options.push_back(member);
+    }
+    job._arguments.push_back("Photo_Mosaic_Generator.exe");
+    Parameters::toArguments(options, job._arguments);
+
+    if (job._id.empty())
+        job._id = std::to_string(_nbReceived);
+    job._receivedTime = std::chrono::steady_clock::now();
+    _nbReceived++;
+    return true;
+}
+
+void MosaicServer::pushJob(const Job& job)
+{
+    {
+        const std::lock_guard<std::mutex> lock(_queueMutex);
+        _queues[job._user].push_back(job);
+        _nbQueued++;
+
+        std::stringstream message;
+        message << "{\"id\":" << JsonUtils::escape(job._id) << ",\"status\":\"queued\",\"queue\":" << _nbQueued << ",\"running\":" << _nbRunning << "}";
+        report(message.str());
+    }
+    _queueCondition.notify_one();
+}
+
+bool MosaicServer::popJob(Job& job)
+{
+    //Round robin over users with pending jobs, queue lock is held by caller
+    if (_queues.empty())
+        return false;
+
+    auto it = _queues.upper_bound(_lastUser);
+    if (it == _queues.end())
+        it = _queues.begin();
+
+    job = std::move(it->second.front());
+    it->second.pop_front();
+    _lastUser = it->first;
+    if (it->second.empty())
+        _queues.erase(it);
+
+    _nbQueued--;
+    _nbRunning++;
+    return true;
+}
+
+void MosaicServer::runWorker(int workerId)
+{
+    //Workers share the cores, parallel regions of a job do not oversubscribe them
+    omp_set_num_threads(_nbWorkerThreads);
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_queueMutex);
+            _queueCondition.wait(lock, [this] { return _nbQueued > 0 || _closed; });
+            if (!popJob(job))
+                return;
+
+            std::stringstream message;
+            message << std::fixed << std::setprecision(3) << "{\"id\":" << JsonUtils::escape(job._id) << ",\"status\":\"running\",\"wait\":" << elapsedSeconds(job._receivedTime, std::chrono::steady_clock::now());
+            message << ",\"queue\":" << _nbQueued << ",\"running\":" << _nbRunning << "}";
+            report(message.str());
+        }
+
+        const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        std::string error;
+        const bool success = runJob(job, workerId, error);
+        const std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+
+        {
+            const std::lock_guard<std::mutex> lock(_queueMutex);
+            _nbRunning--;
+
+            //Latency covers queue wait and run time
+            std::stringstream message;
+            message << std::fixed << std::setprecision(3) << "{\"id\":" << JsonUtils::escape(job._id) << ",\"status\":\"" << (success ? "done" : "error") << "\"";
+            if (!success)
+                message << ",\"message\":" << JsonUtils::escape(error);
+            message << ",\"latency\":" << elapsedSeconds(job._receivedTime, endTime) << ",\"run\":" << elapsedSeconds(startTime, endTime);
+            message << ",\"queue\":" << _nbQueued << ",\"running\":" << _nbRunning << "}";
+            report(message.str());
+        }
+        Log::Logger::get().log(Log::INFO) << "Job " << job._id << (success ? " done" : " failed") << " in " << elapsedSeconds(job._receivedTime, endTime) << "s";
+    }
+}
+
+bool MosaicServer::runJob(const Job& job, int workerId, std::string& error)
+{
+    try
+    {
+        std::vector<std::string> arguments = job._arguments;
+        std::vector<char*> argv;
+        for (auto& argument : arguments)
+            argv.push_back(argument.data());
+
+        Parameters parameters;
+        parameters.initialize((int)argv.size(), argv.data());
+        if (parameters.getServer())
+            throw CustomException("Server option can not be used in a job", CustomException::Level::NORMAL);
+
+        std::shared_ptr<TileLibrary> library = parameters.getRender() ? nullptr : getLibrary(parameters.getTilesPath(), MosaicGenerator::getTileReduction(parameters));
+        MosaicGenerator generator(parameters, library, _rois[workerId]);
+        generator.Build();
+    }
+    catch (CustomException& e)
+    {
+        error = e.getLevel() == CustomException::Level::HELP ? "Help is not available in server mode" : e.what();
+        Log::Logger::get().log(Log::ERROR) << "Job " << job._id << " : " << error;
+        return false;
+    }
+    catch (std::exception& e)
+    {
+        error = e.what();
+        Log::Logger::get().log(Log::ERROR) << "Job " << job._id << " : " << error;
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<TileLibrary> MosaicServer::getLibrary(const std::string& tilesPath, int reduction)
+{
+    //Preview jobs decode reduced images and keep their own library
+    const std::string key = tilesPath + "|" + std::to_string(reduction);
+    const std::lock_guard<std::mutex> lock(_libraryMutex);
+    auto it = _libraries.find(key);
+    if (it != _libraries.end())
+        return it->second;
+
+    std::shared_ptr<TileLibrary> library = std::make_shared<TileLibrary>(tilesPath, reduction);
+    if (!library)
+        throw CustomException("Bad allocation for library in MosaicServer.", CustomException::Level::ERROR);
+    _libraries.emplace(key, library);
+    Log::Logger::get().log(Log::INFO) << "Tile library added : " << tilesPath << " (decode reduction " << reduction << ")";
+    return library;
+}
+
+void MosaicServer::report(const std::string& message)
+{
+    const std::lock_guard<std::mutex> lock(_reportMutex);
+    std::cout << message << std::endl;
+}
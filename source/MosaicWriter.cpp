@@ -0,0 +1,44 @@
+#include "MosaicWriter.h"
+#include "JpegWriter.h"
+#include "DeepZoomWriter.h"
+#include "CustomException.h"
+
+
+bool MosaicWriter::findFormat(const std::string& name, Format& format)
+{
+    for (Format candidate : Formats)
+    {
+        if (getExtension(candidate) == name)
+        {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string MosaicWriter::getExtension(Format format)
+{
+    switch (format)
+    {
+    case JPEG:
+        return "jpg";
+    case DEEP_ZOOM:
+        return "dzi";
+    default:
+        throw CustomException("Unknown mosaic format.", CustomException::Level::ERROR);
+    }
+}
+
+std::unique_ptr<MosaicWriter> MosaicWriter::create(Format format, const std::string& path, const cv::Size& size, int quality)
+{
+    switch (format)
+    {
+    case JPEG:
+        return std::make_unique<JpegWriter>(path, size, quality);
+    case DEEP_ZOOM:
+        return std::make_unique<DeepZoomWriter>(path, size, quality);
+    default:
+        throw CustomException("Unknown mosaic format.", CustomException::Level::ERROR);
+    }
+}
@@ -16,6 +16,20 @@ Parameters::Parameters() :
         ("r,resolution", "Resolution values (width, height) for outputs. Not compatible with scale usage.Separator [,].", cxxopts::value<std::vector<int>>())
         ("c,crop", "Allow cropping photo when resolution mode is enabled. Can only be used with resolution option.")
         ("b,blending", "Blending values for outputs. Could be one or three values: step for exported mosaics [0.01;1], minimum value >= 0, maximum value <= 1. Separator [,].", cxxopts::value<std::vector<double>>()->default_value("0.1"))
+        ("q,quantization", "Color quantization step used to reduce tiles with many colors before color model fitting [0;64]. Higher values are faster but less accurate, 0 for exact fitting.", cxxopts::value<int>()->default_value("0"))
+        ("precompute", "Precompute color models of every tile in background while mosaics are built. Models are cached in tiles folder for later runs.")
+        ("m,cell-tolerance", "Color tolerance used to group near-identical photo cells [0;64]. Grouped cells warm start their color model from a shared fit, 0 to fit every cell independently.", cxxopts::value<int>()->default_value("0"))
+        ("e,engine", "Color transfer engine : gmm (gaussian mixtures optimal transport, best fidelity), reinhard (Lab mean and deviation matching) or histogram (per channel histogram matching). Lightweight engines skip color model fitting.", cxxopts::value<std::string>()->default_value("gmm"))
+        ("quality", "JPEG quality of exported mosaics [1;100].", cxxopts::value<int>()->default_value("100"))
+        ("f,format", "Mosaic output format : jpg (single image) or dzi (Deep Zoom tile pyramid for zoom viewers).", cxxopts::value<std::string>()->default_value("jpg"))
+        ("k,checkpoint", "Checkpoint file storing match solution and color models of the mosaic, written after mosaic generation.", cxxopts::value<std::string>())
+        ("render", "Render mosaics from checkpoint only, without matching and color model fitting. Photo, tiles, grid and engine come from checkpoint, blending, quality and format options are applied.")
+        ("preview", "Fast low resolution preview : small tiles from reduced image decodes, no face detection and reinhard color transfer. A preview checkpoint is always saved (photo folder by default), a later run with this checkpoint, same photo and grid renders at full quality with the preview tile matching.")
+        ("server", "Server mode : tile libraries, features and face detectors stay loaded between jobs. Jobs are read from standard input, one JSON object per line with option names as keys plus optional \"id\" and \"user\", and are reported on standard output. Tiles path preloads a library.")
+        ("jobs", "Number of jobs run concurrently in server mode [1;16], cores are shared between jobs.", cxxopts::value<int>()->default_value("2"))
+        ("batch", "Manifest of target photos sharing tiles folder scan, duplicate removal and tile computing. One target per line : a photo path, or a JSON object with option names as keys overriding command line options.", cxxopts::value<std::string>())
+        ("n,name", "Name prefix of exported mosaics and preview checkpoint. Batch targets are named after their photo by default.", cxxopts::value<std::string>())
+        ("verbose", "Write debug logs in release builds, with coreset fit BIC differences against exact fits (slower, exact fits are computed for the report).")
         ("h,help", "Print usage");
 }
 
@@ -25,15 +39,34 @@ void Parameters::initialize(int argc, char* argv[])
     check();
 
     Log::Logger::get().log(Log::TRACE) << "Parameter checked.";
-    Log::Logger::get().log(Log::DEBUG) << "Photo path : " << _photoPath.value();
-    Log::Logger::get().log(Log::DEBUG) << "Tiles path : " << _tilesPath.value();
-    Log::Logger::get().log(Log::DEBUG) << "Grid : " << _grid.value();
+    if (!_render && !_server && !_batchPath.has_value())
+    {
+        Log::Logger::get().log(Log::DEBUG) << "Photo path : " << _photoPath.value();
+        Log::Logger::get().log(Log::DEBUG) << "Tiles path : " << _tilesPath.value();
+        Log::Logger::get().log(Log::DEBUG) << "Grid : " << _grid.value();
+    }
     if (_scale.has_value())
         Log::Logger::get().log(Log::DEBUG) << "Scale : " << _scale.value();
     if (_resolution.has_value())
         Log::Logger::get().log(Log::DEBUG) << "Resolution : " << _resolution.value();
     Log::Logger::get().log(Log::DEBUG) << "Crop : " << (_crop ? "true" : "false");
     Log::Logger::get().log(Log::DEBUG) << "Blending : " << _blending.value();
+    Log::Logger::get().log(Log::DEBUG) << "Quantization : " << _quantization.value();
+    Log::Logger::get().log(Log::DEBUG) << "Precompute : " << (_precompute ? "true" : "false");
+    Log::Logger::get().log(Log::DEBUG) << "Cell tolerance : " << _cellTolerance.value();
+    Log::Logger::get().log(Log::DEBUG) << "Color engine : " << _colorEngine.value();
+    Log::Logger::get().log(Log::DEBUG) << "Quality : " << _quality.value();
+    Log::Logger::get().log(Log::DEBUG) << "Format : " << _format.value();
+    if (_checkpointPath.has_value())
+        Log::Logger::get().log(Log::DEBUG) << "Checkpoint : " << _checkpointPath.value();
+    Log::Logger::get().log(Log::DEBUG) << "Render : " << (_render ? "true" : "false");
+    Log::Logger::get().log(Log::DEBUG) << "Preview : " << (_preview ? "true" : "false");
+    Log::Logger::get().log(Log::DEBUG) << "Server : " << (_server ? "true" : "false");
+    Log::Logger::get().log(Log::DEBUG) << "Jobs : " << _nbJobs.value();
+    if (_batchPath.has_value())
+        Log::Logger::get().log(Log::DEBUG) << "Batch : " << _batchPath.value();
+    if (_name.has_value())
+        Log::Logger::get().log(Log::DEBUG) << "Name : " << _name.value();
 }
 
 std::string Parameters::getPhotoPath() const
@@ -43,7 +76,7 @@ std::string Parameters::getPhotoPath() const
 
 std::string Parameters::getTilesPath() const
 {
-    return _tilesPath.value();
+    return _tilesPath.has_value() ? _tilesPath.value() : "";
 }
 
 std::tuple<int, int>  Parameters::getGrid() const
@@ -69,6 +102,119 @@ std::tuple<double, double, double>  Parameters::getBlending() const
     return std::make_tuple(_blending.value()[0], _blending.value()[1], _blending.value()[2]);
 }
 
+int Parameters::getQuantization() const
+{
+    return _quantization.value();
+}
+
+bool Parameters::getPrecompute() const
+{
+    return _precompute;
+}
+
+bool Parameters::getVerbose() const
+{
+    return _verbose;
+}
+
+int Parameters::getCellTolerance() const
+{
+    return _cellTolerance.value();
+}
+
+ColorTransfer::Engine Parameters::getColorEngine() const
+{
+    ColorTransfer::Engine engine = ColorTransfer::GMM_OT;
+    ColorTransfer::findEngine(_colorEngine.value(), engine);
+    return engine;
+}
+
+int Parameters::getQuality() const
+{
+    return _quality.value();
+}
+
+MosaicWriter::Format Parameters::getFormat() const
+{
+    MosaicWriter::Format format = MosaicWriter::JPEG;
+    MosaicWriter::findFormat(_format.value(), format);
+    return format;
+}
+
+std::string Parameters::getCheckpointPath() const
+{
+    return _checkpointPath.has_value() ? _checkpointPath.value() : "";
+}
+
+bool Parameters::getRender() const
+{
+    return _render;
+}
+
+bool Parameters::getPreview() const
+{
+    return _preview;
+}
+
+bool Parameters::getServer() const
+{
+    return _server;
+}
+
+int Parameters::getNbJobs() const
+{
+    return _nbJobs.value();
+}
+
+std::string Parameters::getBatchPath() const
+{
+    return _batchPath.has_value() ? _batchPath.value() : "";
+}
+
+std::string Parameters::getName() const
+{
+    return _name.has_value() ? _name.value() : "";
+}
+
+Parameters Parameters::createTarget(const std::vector<std::string>& arguments) const
+{
+    //Target options override batch options, mandatory values are checked for each target
+    //Name and checkpoint would be shared by all targets of a batch, they are only accepted per target
+    if (_batchPath.has_value() && (_name.has_value() || _checkpointPath.has_value()))
+        throw CustomException("Name and checkpoint options must be set per target in a batch manifest", CustomException::Level::NORMAL);
+    Parameters target(*this);
+    target._batchPath.reset();
+
+    std::vector<std::string> targetArguments = arguments;
+    std::vector<char*> argv;
+    for (auto& argument : targetArguments)
+        argv.push_back(argument.data());
+    target.parse((int)argv.size(), argv.data());
+    if (target._batchPath.has_value() || target._server)
+        throw CustomException("Batch and server options can not be used in a batch target", CustomException::Level::NORMAL);
+    target.check();
+    return target;
+}
+
+void Parameters::toArguments(const std::vector<JsonUtils::Member>& members, std::vector<std::string>& arguments)
+{
+    //JSON members are mapped to command line options, booleans are flags and null values are ignored
+    for (const auto& member : members)
+    {
+        const std::string option = (member._key.size() == 1 ? "-" : "--") + member._key;
+        if (member._type == JsonUtils::BOOLEAN)
+        {
+            if (member._value == "true")
+                arguments.push_back(option);
+        }
+        else if (member._type != JsonUtils::NUL)
+        {
+            arguments.push_back(option);
+            arguments.push_back(member._value);
+        }
+    }
+}
+
 std::string Parameters::getHelp() const
 {
     return "------- HELP -------\n" + _options.help();
@@ -115,7 +261,36 @@ void Parameters::parse(int argc, char* argv[])
         _resolution = result["resolution"].as<std::vector<int>>();
     if (result.count("crop"))
         _crop = true;
-    _blending = result["blending"].as<std::vector<double>>();
+    if (result.count("blending") || !_blending.has_value())
+        _blending = result["blending"].as<std::vector<double>>();
+    if (result.count("quantization") || !_quantization.has_value())
+        _quantization = result["quantization"].as<int>();
+    if (result.count("precompute"))
+        _precompute = true;
+    if (result.count("verbose"))
+        _verbose = true;
+    if (result.count("cell-tolerance") || !_cellTolerance.has_value())
+        _cellTolerance = result["cell-tolerance"].as<int>();
+    if (result.count("engine") || !_colorEngine.has_value())
+        _colorEngine = result["engine"].as<std::string>();
+    if (result.count("quality") || !_quality.has_value())
+        _quality = result["quality"].as<int>();
+    if (result.count("format") || !_format.has_value())
+        _format = result["format"].as<std::string>();
+    if (result.count("checkpoint"))
+        _checkpointPath = result["checkpoint"].as<std::string>();
+    if (result.count("render"))
+        _render = true;
+    if (result.count("preview"))
+        _preview = true;
+    if (result.count("server"))
+        _server = true;
+    if (result.count("batch"))
+        _batchPath = result["batch"].as<std::string>();
+    if (result.count("name"))
+        _name = result["name"].as<std::string>();
+    if (result.count("jobs") || !_nbJobs.has_value())
+        _nbJobs = result["jobs"].as<int>();
 }
 
 void Parameters::check()
@@ -123,61 +298,109 @@ void Parameters::check()
     std::string message = "Arguments check : ";
     unsigned int errorCount = 0;
 
-    if (!_photoPath.has_value())
+    if (_server || _batchPath.has_value())
     {
-        message += "\nNo photo defined";
-        errorCount++;
-    }
-    else
-    {
-        std::replace(_photoPath.value().begin(), _photoPath.value().end(), '/', '\\');
-        if (!std::filesystem::exists(_photoPath.value()))
+        //Job and target options are checked when jobs are received and targets are read
+        if (_server && _batchPath.has_value())
         {
-            message += "\nInvalid file : " + _photoPath.value();
+            message += "\nBatch mode not compatible with server mode";
             errorCount++;
         }
-    }
-
-    if (!_tilesPath.has_value())
-    {
-        message += "\nNo tiles path defined";
-        errorCount++;
-    }
-    else 
-    {
-        std::replace(_tilesPath.value().begin(), _tilesPath.value().end(), '/', '\\');
-        if (_tilesPath.value().back() != '\\')
-            _tilesPath.value() += "\\";
-
-        if (!std::filesystem::exists(_tilesPath.value()))
+        if (_batchPath.has_value() && !std::filesystem::exists(_batchPath.value()))
         {
-            message += "\nInvalid path : " + _tilesPath.value();
+            message += "\nInvalid file : " + _batchPath.value();
             errorCount++;
         }
-    }
+        if (_tilesPath.has_value())
+        {
+            std::replace(_tilesPath.value().begin(), _tilesPath.value().end(), '/', '\\');
+            if (_tilesPath.value().back() != '\\')
+                _tilesPath.value() += "\\";
 
-    if (!_grid.has_value())
-    {
-        message += "\nNo grid values defined";
-        errorCount++;
+            if (!std::filesystem::exists(_tilesPath.value()))
+            {
+                message += "\nInvalid path : " + _tilesPath.value();
+                errorCount++;
+            }
+        }
     }
-    else if (_grid.value().empty() || _grid.value().size() > 2)
+    else if (_render)
     {
-        message += "\nWrong number of grid elements : " + std::to_string(_grid.value().size());
-        errorCount++;
+        //Photo, tiles and grid are read from checkpoint
+        if (_preview)
+        {
+            message += "\nRender mode not compatible with preview, preview checkpoints are rendered in preview mode";
+            errorCount++;
+        }
+        if (!_checkpointPath.has_value())
+        {
+            message += "\nNo checkpoint defined for render mode";
+            errorCount++;
+        }
+        else if (!std::filesystem::exists(_checkpointPath.value()))
+        {
+            message += "\nInvalid file : " + _checkpointPath.value();
+            errorCount++;
+        }
     }
     else
     {
-        for (int i = 0; i < _grid.value().size(); i++)
+        if (!_photoPath.has_value())
         {
-            if (_grid.value()[i] <= 0)
+            message += "\nNo photo defined";
+            errorCount++;
+        }
+        else
+        {
+            std::replace(_photoPath.value().begin(), _photoPath.value().end(), '/', '\\');
+            if (!std::filesystem::exists(_photoPath.value()))
             {
-                message += "\nInvalid grid value : " + std::to_string(_grid.value()[i]);
+                message += "\nInvalid file : " + _photoPath.value();
                 errorCount++;
             }
         }
-        if (_grid.value().size() == 1)
-            _grid.value().emplace_back(_grid.value()[0]);
+
+        if (!_tilesPath.has_value())
+        {
+            message += "\nNo tiles path defined";
+            errorCount++;
+        }
+        else 
+        {
+            std::replace(_tilesPath.value().begin(), _tilesPath.value().end(), '/', '\\');
+            if (_tilesPath.value().back() != '\\')
+                _tilesPath.value() += "\\";
+
+            if (!std::filesystem::exists(_tilesPath.value()))
+            {
+                message += "\nInvalid path : " + _tilesPath.value();
+                errorCount++;
+            }
+        }
+
+        if (!_grid.has_value())
+        {
+            message += "\nNo grid values defined";
+            errorCount++;
+        }
+        else if (_grid.value().empty() || _grid.value().size() > 2)
+        {
+            message += "\nWrong number of grid elements : " + std::to_string(_grid.value().size());
+            errorCount++;
+        }
+        else
+        {
+            for (int i = 0; i < _grid.value().size(); i++)
+            {
+                if (_grid.value()[i] <= 0)
+                {
+                    message += "\nInvalid grid value : " + std::to_string(_grid.value()[i]);
+                    errorCount++;
+                }
+            }
+            if (_grid.value().size() == 1)
+                _grid.value().emplace_back(_grid.value()[0]);
+        }
     }
 
     if (_scale.has_value() && _resolution.has_value())
@@ -264,6 +487,44 @@ void Parameters::check()
         }
     }
 
+    if (_quantization.has_value() && (_quantization.value() < 0 || 64 < _quantization.value()))
+    {
+        message += "\nInvalid quantization value : " + std::to_string(_quantization.value());
+        errorCount++;
+    }
+
+    if (_cellTolerance.has_value() && (_cellTolerance.value() < 0 || 64 < _cellTolerance.value()))
+    {
+        message += "\nInvalid cell tolerance value : " + std::to_string(_cellTolerance.value());
+        errorCount++;
+    }
+
+    ColorTransfer::Engine engine;
+    if (_colorEngine.has_value() && !ColorTransfer::findEngine(_colorEngine.value(), engine))
+    {
+        message += "\nInvalid color engine : " + _colorEngine.value();
+        errorCount++;
+    }
+
+    if (_quality.has_value() && (_quality.value() < 1 || 100 < _quality.value()))
+    {
+        message += "\nInvalid quality value : " + std::to_string(_quality.value());
+        errorCount++;
+    }
+
+    if (_nbJobs.has_value() && (_nbJobs.value() < 1 || 16 < _nbJobs.value()))
+    {
+        message += "\nInvalid jobs value : " + std::to_string(_nbJobs.value());
+        errorCount++;
+    }
+
+    MosaicWriter::Format format;
+    if (_format.has_value() && !MosaicWriter::findFormat(_format.value(), format))
+    {
+        message += "\nInvalid format : " + _format.value();
+        errorCount++;
+    }
+
     if (errorCount > 0)
     {
         throw CustomException(message, CustomException::Level::NORMAL);
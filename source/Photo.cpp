@@ -5,22 +5,67 @@
 #include "Log.h"
 
 
-Photo::Photo(const std::string& path, std::tuple<int, int> grid, double scale, std::tuple<int, int, bool> resolution) :
-    _filePath(path), _gridWidth(std::get<0>(grid)), _gridHeight(std::get<1>(grid)), _scale(scale), _resolutionWidth(std::get<0>(resolution)), _resolutionHeight(std::get<1>(resolution)), _resolutionCrop(std::get<2>(resolution))
+Photo::Photo(const std::string& path, std::tuple<int, int> grid, double scale, std::tuple<int, int, bool> resolution, int previewTileSize) :
+    _filePath(path), _gridWidth(std::get<0>(grid)), _gridHeight(std::get<1>(grid)), _scale(scale), _resolutionWidth(std::get<0>(resolution)), _resolutionHeight(std::get<1>(resolution)), _resolutionCrop(std::get<2>(resolution)), _previewTileSize(previewTileSize)
 {
 }
 
 void Photo::initialize()
+{
+    cv::Mat inputImage;
+    readImage(inputImage);
+
+    _inputSize = inputImage.size();
+    cv::Size resampleSize, targetSize;
+    computeSizes(_inputSize, resampleSize, targetSize, _tileSize);
+
+    cv::Mat resampledPhoto;
+    ImageUtils::resample(resampledPhoto, resampleSize, inputImage, ImageUtils::LANCZOS);
+
+    _croppedSize = cv::Size(resampledPhoto.cols - _gridWidth * _tileSize.width, resampledPhoto.rows - _gridHeight * _tileSize.height);
+    const int nbTiles = _gridWidth * _gridHeight;
+    _tiles.reserve(nbTiles);
+    for (int mosaicId = 0; mosaicId < nbTiles; mosaicId++)
+    {
+        _tiles.emplace_back(_tileSize, CV_8UC3);
+        computeTile(resampledPhoto, mosaicId);
+    }
+
+    Log::Logger::get().log(Log::INFO) << "Photo size  : " << _inputSize.width << "*" << _inputSize.height;
+    Log::Logger::get().log(Log::INFO) << "Mosaic size : " << resampledPhoto.cols - _croppedSize.width << "*" << resampledPhoto.rows - _croppedSize.height;
+    Log::Logger::get().log(Log::INFO) << "Cropped size   : " << _croppedSize.width << "*" << _croppedSize.height;
+    Log::Logger::get().log(Log::INFO) << "Tile size   : " << _tileSize.width << "*" << _tileSize.height;
+}
+
+cv::Size Photo::computeTileSize() const
+{
+    //JPEG size is read from its header, other formats are decoded for their size only
+    cv::Size inputSize;
+    if (!ImageUtils::readJpegSize(_filePath, inputSize))
+    {
+        cv::Mat inputImage;
+        readImage(inputImage);
+        inputSize = inputImage.size();
+    }
+
+    cv::Size resampleSize, targetSize, tileSize;
+    computeSizes(inputSize, resampleSize, targetSize, tileSize);
+    return tileSize;
+}
+
+void Photo::readImage(cv::Mat& image) const
 {
     OutputManager::get().cstderr_silent();
-    cv::Mat inputImage = cv::imread(_filePath);
+    image = cv::imread(_filePath);
     OutputManager::get().cstderr_restore();
-    if (!inputImage.data)
+    if (!image.data)
         throw CustomException("Impossible to load image : " + _filePath, CustomException::Level::ERROR);
+}
 
-    _inputSize = inputImage.size();
-    cv::Size resampleSize = _inputSize;
-    cv::Size targetSize = _inputSize;
+void Photo::computeSizes(const cv::Size& inputSize, cv::Size& resampleSize, cv::Size& targetSize, cv::Size& tileSize) const
+{
+    resampleSize = inputSize;
+    targetSize = inputSize;
     if (_scale > 0)
     {
         targetSize = resampleSize = cv::Size((int)((double)resampleSize.width * _scale), (int)((double)resampleSize.height * _scale));
@@ -30,7 +75,7 @@ void Photo::initialize()
         targetSize = resampleSize = cv::Size(_resolutionWidth, _resolutionHeight);
         if (_resolutionCrop)
         {
-            double inputRatio = (double)_inputSize.width / (double)_inputSize.height;
+            double inputRatio = (double)inputSize.width / (double)inputSize.height;
             double targetRatio = (double)_resolutionWidth / (double)_resolutionHeight;
             if (inputRatio < targetRatio)
                 resampleSize.height = (int)((double)targetSize.width / inputRatio);
@@ -38,26 +83,20 @@ void Photo::initialize()
                 resampleSize.width = (int)((double)targetSize.height * inputRatio);
         }
     }
-    cv::Mat resampledPhoto;
-    ImageUtils::resample(resampledPhoto, resampleSize, inputImage, ImageUtils::LANCZOS);
-
-    _tileSize = cv::Size(targetSize.width / _gridWidth, targetSize.height / _gridHeight);
-    if (_tileSize.width < MinTileSize || _tileSize.height < MinTileSize)
-        throw CustomException("Image subdivision leads to tiles with " + std::to_string(_tileSize.width) + "*" + std::to_string(_tileSize.height) + " size (minimum is " + std::to_string(MinTileSize) + "*" + std::to_string(MinTileSize) + ")", CustomException::Level::ERROR);
-    
-    _croppedSize = cv::Size(resampledPhoto.cols - _gridWidth * _tileSize.width, resampledPhoto.rows - _gridHeight * _tileSize.height);
-    const int nbTiles = _gridWidth * _gridHeight;
-    _tiles.reserve(nbTiles);
-    for (int mosaicId = 0; mosaicId < nbTiles; mosaicId++)
+    if (_previewTileSize > 0)
     {
-        _tiles.emplace_back(_tileSize, CV_8UC3);
-        computeTile(resampledPhoto, mosaicId);
+        //Preview is reduced until its smallest tile side reaches preview tile size
+        const double reduction = std::max((double)_previewTileSize * _gridWidth / targetSize.width, (double)_previewTileSize * _gridHeight / targetSize.height);
+        if (reduction < 1.)
+        {
+            targetSize = cv::Size((int)ceil(targetSize.width * reduction), (int)ceil(targetSize.height * reduction));
+            resampleSize = cv::Size(std::max((int)(resampleSize.width * reduction), targetSize.width), std::max((int)(resampleSize.height * reduction), targetSize.height));
+        }
     }
 
-    Log::Logger::get().log(Log::INFO) << "Photo size  : " << _inputSize.width << "*" << _inputSize.height;
-    Log::Logger::get().log(Log::INFO) << "Mosaic size : " << resampledPhoto.cols - _croppedSize.width << "*" << resampledPhoto.rows - _croppedSize.height;
-    Log::Logger::get().log(Log::INFO) << "Cropped size   : " << _croppedSize.width << "*" << _croppedSize.height;
-    Log::Logger::get().log(Log::INFO) << "Tile size   : " << _tileSize.width << "*" << _tileSize.height;
+    tileSize = cv::Size(targetSize.width / _gridWidth, targetSize.height / _gridHeight);
+    if (tileSize.width < MinTileSize || tileSize.height < MinTileSize)
+        throw CustomException("Image subdivision leads to tiles with " + std::to_string(tileSize.width) + "*" + std::to_string(tileSize.height) + " size (minimum is " + std::to_string(MinTileSize) + "*" + std::to_string(MinTileSize) + ")", CustomException::Level::ERROR);
 }
 
 cv::Rect Photo::getTileBox(int mosaicId) const
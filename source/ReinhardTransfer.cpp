@@ -0,0 +1,77 @@
+#include "ReinhardTransfer.h"
+#include "ColorUtils.h"
+
+
+ReinhardTransfer::Source::Source(const ProbaUtils::Histogram<3>& histogram) :
+    _histogram(histogram)
+{
+    computeLabStatistics(_mean, _deviation, _labValues, _histogram);
+}
+
+ReinhardTransfer::Source::~Source()
+{
+}
+
+ColorTransfer::CostProfile ReinhardTransfer::getCostProfile()
+{
+    return {"reinhard", false, "Lab conversion of unique colors", "Lab statistics of cell colors, one conversion per unique tile color"};
+}
+
+ReinhardTransfer::ReinhardTransfer(const Source& source, const cv::Mat& cell) :
+    _source(source)
+{
+    ProbaUtils::Histogram<3> cellHistogram;
+    ProbaUtils::computeHistogram(cellHistogram, cell.data, cell.rows * cell.cols);
+
+    std::vector<MathUtils::VectorNd<3>> cellLabValues;
+    computeLabStatistics(_targetMean, _targetDeviation, cellLabValues, cellHistogram);
+}
+
+ReinhardTransfer::~ReinhardTransfer()
+{
+}
+
+void ReinhardTransfer::apply(cv::Mat& enhancedImage, double blending)
+{
+    //Statistics are blended between tile and cell, blending 0 keeps tile colors
+    const MathUtils::VectorNd<3> mean = (1. - blending) * _source._mean + blending * _targetMean;
+    const MathUtils::VectorNd<3> deviation = (1. - blending) * _source._deviation + blending * _targetDeviation;
+    const MathUtils::VectorNd<3> scale = deviation.cwiseQuotient(_source._deviation.cwiseMax(MinDeviation));
+
+    const ProbaUtils::Histogram<3>& histogram = _source._histogram;
+    const int nbValues = histogram._values.size();
+    std::vector<uchar> colorMap(nbValues * 3);
+    for (int h = 0; h < nbValues; h++)
+    {
+        const MathUtils::VectorNd<3> lab = (_source._labValues[h] - _source._mean).cwiseProduct(scale) + mean;
+        ColorUtils::LABtoBGR(colorMap[3 * h], colorMap[3 * h + 1], colorMap[3 * h + 2], lab(0), lab(1), lab(2));
+    }
+
+    const int nbPixels = enhancedImage.rows * enhancedImage.cols;
+    for (int p = 0, k = 0; p < nbPixels; p++)
+    {
+        const int mapId = histogram._mapId[p];
+        for (int c = 0; c < 3; c++, k++)
+            enhancedImage.data[k] = colorMap[3 * mapId + c];
+    }
+}
+
+void ReinhardTransfer::computeLabStatistics(MathUtils::VectorNd<3>& mean, MathUtils::VectorNd<3>& deviation, std::vector<MathUtils::VectorNd<3>>& labValues, const ProbaUtils::Histogram<3>& histogram)
+{
+    const int nbValues = histogram._values.size();
+    labValues.resize(nbValues);
+    mean.setZero();
+    deviation.setZero();
+
+    for (int h = 0; h < nbValues; h++)
+    {
+        const MathUtils::VectorNd<3>& value = histogram._values[h];
+        ColorUtils::BGRtoLAB(labValues[h](0), labValues[h](1), labValues[h](2), (uchar)value(0), (uchar)value(1), (uchar)value(2));
+        mean += histogram._counts[h] * labValues[h];
+    }
+    mean /= histogram._nbData;
+
+    for (int h = 0; h < nbValues; h++)
+        deviation += histogram._counts[h] * (labValues[h] - mean).cwiseAbs2();
+    deviation = (deviation / histogram._nbData).cwiseSqrt();
+}
@@ -0,0 +1,144 @@
+#include "TileLibrary.h"
+#include "CustomException.h"
+#include "Log.h"
+#include <algorithm>
+
+
+std::atomic<int> TileLibrary::_nbComputed(0);
+
+TileLibrary::TileLibrary(const std::string& path, int reduction) :
+    _tiles(path, reduction), _modelCache(path), _initialized(false)
+{
+}
+
+TileLibrary::~TileLibrary()
+{
+}
+
+void TileLibrary::initialize(int minNbTiles)
+{
+    //Concurrent mosaics wait for the first scan, a failed scan is tried again by the next one
+    const std::lock_guard<std::mutex> lock(_mutex);
+    if (_initialized)
+        return;
+
+    _tiles.initialize(minNbTiles);
+    _duplicateRemover.run(_tiles);
+    _initialized = true;
+}
+
+std::shared_ptr<const Tiles> TileLibrary::compute(const FaceDetectionROI& roi, const cv::Size& tileSize)
+{
+    return compute(roi, std::vector<cv::Size>(1, tileSize)).front();
+}
+
+std::vector<std::shared_ptr<const Tiles>> TileLibrary::compute(const FaceDetectionROI& roi, const std::vector<cv::Size>& tileSizes)
+{
+    //Missing tile sizes are computed together, sizes computed by other mosaics are waited for
+    std::vector<ComputedTiles> computedTiles(tileSizes.size());
+    std::vector<std::promise<std::shared_ptr<const Tiles>>> promises;
+    std::vector<int> ownedSizes;
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        if (!_initialized)
+            throw CustomException("Tile library used before initialization.", CustomException::Level::ERROR);
+
+        for (int s = 0; s < tileSizes.size(); s++)
+        {
+            const SizeKey key(tileSizes[s].width, tileSizes[s].height);
+            auto it = _computed.find(key);
+            if (it != _computed.end())
+            {
+                computedTiles[s] = it->second;
+                continue;
+            }
+            promises.emplace_back();
+            computedTiles[s] = promises.back().get_future().share();
+            _computed.emplace(key, computedTiles[s]);
+            _computedOrder.push_back(key);
+            ownedSizes.push_back(s);
+        }
+        evict();
+    }
+
+    if (!ownedSizes.empty())
+    {
+        try
+        {
+            std::vector<std::shared_ptr<Tiles>> sizeTiles;
+            std::vector<Tiles*> sizeTilesPtr;
+            std::vector<cv::Size> sizes;
+            for (int s : ownedSizes)
+            {
+                sizeTiles.push_back(std::make_shared<Tiles>(_tiles, computeTempName()));
+                if (!sizeTiles.back())
+                    throw CustomException("Bad allocation for tiles in TileLibrary.", CustomException::Level::ERROR);
+                sizeTilesPtr.push_back(sizeTiles.back().get());
+                sizes.push_back(tileSizes[s]);
+            }
+            Tiles::compute(roi, sizeTilesPtr, sizes);
+            for (int o = 0; o < ownedSizes.size(); o++)
+                promises[o].set_value(sizeTiles[o]);
+        }
+        catch (...)
+        {
+            {
+                const std::lock_guard<std::mutex> lock(_mutex);
+                for (int s : ownedSizes)
+                {
+                    const SizeKey key(tileSizes[s].width, tileSizes[s].height);
+                    _computed.erase(key);
+                    _computedOrder.erase(std::remove(_computedOrder.begin(), _computedOrder.end(), key), _computedOrder.end());
+                }
+            }
+            for (auto& promise : promises)
+                promise.set_exception(std::current_exception());
+            throw;
+        }
+        Log::Logger::get().log(Log::TRACE) << ownedSizes.size() << " tile sizes computed, " << tileSizes.size() - ownedSizes.size() << " reused.";
+    }
+
+    std::vector<std::shared_ptr<const Tiles>> tiles;
+    for (const auto& sizeTiles : computedTiles)
+        tiles.push_back(sizeTiles.get());
+    return tiles;
+}
+
+std::shared_ptr<const Tiles> TileLibrary::compute(const FaceDetectionROI& roi, const cv::Size& tileSize, const std::vector<std::string>& imagePaths)
+{
+    //Given images only, without scan and deduplication, not shared with other mosaics
+    std::shared_ptr<Tiles> tiles = std::make_shared<Tiles>(_tiles, computeTempName());
+    if (!tiles)
+        throw CustomException("Bad allocation for tiles in TileLibrary.", CustomException::Level::ERROR);
+    tiles->initialize(imagePaths);
+    tiles->compute(roi, tileSize);
+    return tiles;
+}
+
+ModelCache& TileLibrary::getModelCache()
+{
+    return _modelCache;
+}
+
+std::string TileLibrary::computeTempName() const
+{
+    return Tiles::TempDir + "_" + std::to_string(_nbComputed++);
+}
+
+void TileLibrary::evict()
+{
+    //Oldest computed tile sizes no longer used by a mosaic are released
+    for (auto it = _computedOrder.begin(); it != _computedOrder.end() && _computedOrder.size() > MaxComputedSizes;)
+    {
+        const ComputedTiles& computedTiles = _computed[*it];
+        if (computedTiles.wait_for(std::chrono::seconds(0)) == std::future_status::ready && computedTiles.get().use_count() == 1)
+        {
+            _computed.erase(*it);
+            it = _computedOrder.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
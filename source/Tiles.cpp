@@ -1,18 +1,25 @@
 #include "Tiles.h"
 #include "CustomException.h"
 #include "OutputManager.h"
+#include "ModelCache.h"
 #include "ImageUtils.h"
 #include "ProgressBar.h"
 #include "Log.h"
 #include "Console.h"
+#include "SystemUtils.h"
 #include <filesystem>
 #include <omp.h>
 
 
 const std::string Tiles::TempDir = "PMG_temp";
 
-Tiles::Tiles(const std::string& path, std::tuple<int, int> grid) :
-    _path(path), _tempPath(path + TempDir), _gridWidth(std::get<0>(grid)), _gridHeight(std::get<1>(grid))
+Tiles::Tiles(const std::string& path, int reduction, const std::string& tempName) :
+    _path(path), _tempPath(path + tempName), _reduction(reduction)
+{
+}
+
+Tiles::Tiles(const Tiles& tiles, const std::string& tempName) :
+    _path(tiles._path), _tempPath(tiles._path + tempName), _reduction(tiles._reduction), _tilesData(tiles._tilesData)
 {
 }
 
@@ -28,7 +35,8 @@ void Tiles::initialize(int minNbTiles)
     {
         if (is_directory(it->path()))
         {
-            if (it->path() == _tempPath)
+            //Skip temporary folders of every tile size
+            if (it->path().filename().string().rfind(TempDir, 0) == 0 || it->path() == _path + ModelCache::CacheDir)
             {
                 it.disable_recursion_pending();
             }
@@ -49,6 +57,21 @@ void Tiles::initialize(int minNbTiles)
         throw CustomException("No sufficient number of tiles, " + std::to_string(_tilesData.size()) + " found but should have at least " + std::to_string(minNbTiles), CustomException::ERROR);
 }
 
+void Tiles::initialize(const std::vector<std::string>& imagePaths)
+{
+    Data data;
+    _tilesData.clear();
+    for (const auto& imagePath : imagePaths)
+    {
+        if (!std::filesystem::exists(imagePath))
+            throw CustomException("Impossible to find tile image : " + imagePath, CustomException::Level::ERROR);
+        data._imagePath = imagePath;
+        _tilesData.emplace_back(data);
+    }
+
+    Log::Logger::get().log(Log::TRACE) << _tilesData.size() << " tiles restored.";
+}
+
 unsigned int Tiles::getNbTiles() const
 {
     return _tilesData.size();
@@ -56,7 +79,7 @@ unsigned int Tiles::getNbTiles() const
 
 void Tiles::readImage(int tileID, cv::Mat& image) const
 {
-    image = cv::imread(_tilesData[tileID]._imagePath);
+    image = cv::imread(_tilesData[tileID]._imagePath, getReadFlags(_reduction));
 }
 
 void Tiles::remove(std::vector<unsigned int>& toRemove)
@@ -84,43 +107,65 @@ void Tiles::remove(std::vector<unsigned int>& toRemove)
     _tilesData.resize(_tilesData.size() - (t2 - t1));
 }
 
-void Tiles::compute(const FaceDetectionROI& roi, const Photo& photo)
+void Tiles::compute(const FaceDetectionROI& roi, const cv::Size& tileSize)
 {
-    removeTemp();
-    createTemp();
+    compute(roi, std::vector<Tiles*>(1, this), std::vector<cv::Size>(1, tileSize));
+}
+
+void Tiles::compute(const FaceDetectionROI& roi, const std::vector<Tiles*>& tiles, const std::vector<cv::Size>& tileSizes)
+{
+    //Tiles share the same image list, each image is decoded and searched for faces once for all tile sizes
+    if (tiles.empty() || tiles.size() != tileSizes.size())
+        throw CustomException("Tiles and tile sizes mismatch in Tiles::compute.", CustomException::Level::ERROR);
+    const int nbTiles = tiles[0]->_tilesData.size();
+    for (const auto* sizeTiles : tiles)
+    {
+        if (sizeTiles->_tilesData.size() != nbTiles)
+            throw CustomException("Tiles computed together should share their images.", CustomException::Level::ERROR);
+        sizeTiles->removeTemp();
+        sizeTiles->createTemp();
+    }
 
-    Console::Out::initBar("Computing tile candidates ", _tilesData.size());
+    Console::Out::initBar("Computing tile candidates ", nbTiles);
     Console::Out::startBar(Console::DEFAULT);
 
     OutputManager::get().cstderr_silent();
-    const int padding = std::to_string(_tilesData.size()).length();
+    const int padding = std::to_string(nbTiles).length();
+    SystemUtils::ParallelErrors errors;
     #pragma omp parallel for
-    for (int t = 0; t < _tilesData.size(); t++)
+    for (int t = 0; t < nbTiles; t++)
     {
-        cv::Mat image;
-        readImage(t, image);
-        std::string index = std::to_string(t);
-        index = std::string(padding - index.length(), '0') + index;
-        _tilesData[t]._tilePath = _tempPath + "\\tile_" + index + ".png";
-        computeTileFeatures(image, roi, photo.getTileSize(), _tilesData[t], omp_get_thread_num());
-        Console::Out::addBarSteps(1);
+        errors.run([&]()
+            {
+                cv::Mat image;
+                tiles[0]->readImage(t, image);
+                if (image.empty())
+                    throw CustomException("Impossible to read tile image : " + tiles[0]->_tilesData[t]._imagePath, CustomException::Level::ERROR);
+                std::string index = std::to_string(t);
+                index = std::string(padding - index.length(), '0') + index;
+                FaceDetectionROI::Detection detection;
+                for (int s = 0; s < tiles.size(); s++)
+                {
+                    Data& data = tiles[s]->_tilesData[t];
+                    data._tilePath = tiles[s]->_tempPath + "\\tile_" + index + ".png";
+                    tiles[s]->computeTileFeatures(image, roi, tileSizes[s], data, detection, omp_get_thread_num());
+                }
+                Console::Out::addBarSteps(1);
+            });
     }
     OutputManager::get().cstderr_restore();
-    Log::Logger::get().log(Log::TRACE) <<"Tiles features computed.";
+    errors.rethrow();
+    Log::Logger::get().log(Log::TRACE) << "Tiles features computed for " << tiles.size() << " tile sizes.";
     Console::Out::waitBar();
+}
 
-    _photoFeatures.resize(_gridWidth * _gridHeight * NbFeatures);
-    for (int mosaicId = 0; mosaicId < _gridWidth * _gridHeight; mosaicId++)
-    {
-        double* features = &_photoFeatures[mosaicId * NbFeatures];
-        ImageUtils::computeFeatures(photo.getTile(mosaicId), features, FeatureDiv, NbFeatures);
-    }
-    Log::Logger::get().log(Log::TRACE) << "Photo features computed.";
+void Tiles::computeFeatures(const cv::Mat& image, double* features)
+{
+    ImageUtils::computeFeatures(image, features, FeatureDiv, NbFeatures);
 }
 
-double Tiles::computeDistance(int i, int j, int tileID) const
+double Tiles::computeDistance(const double* features, int tileID) const
 {
-    const double* features = &_photoFeatures[(i * _gridWidth + j) * NbFeatures];
     return ImageUtils::featureDistance(features, _tilesData[tileID]._features, NbFeatures);
 }
 
@@ -129,6 +174,35 @@ const std::string Tiles::getTileFilepath(int tileId) const
     return _tilesData[tileId]._tilePath;
 }
 
+void Tiles::getTileReference(int tileId, std::string& imagePath, cv::Rect& box) const
+{
+    imagePath = _tilesData[tileId]._imagePath;
+    box = _tilesData[tileId]._box;
+}
+
+void Tiles::computeTile(cv::Mat& tile, const std::string& imagePath, const cv::Rect& box, const cv::Size& tileSize, int reduction)
+{
+    cv::Mat image = cv::imread(imagePath, getReadFlags(reduction));
+    if (image.empty())
+        throw CustomException("Impossible to read tile image : " + imagePath, CustomException::Level::ERROR);
+    ImageUtils::resample(tile, tileSize, image, box, ImageUtils::LANCZOS);
+}
+
+int Tiles::getReadFlags(int reduction)
+{
+    switch (reduction)
+    {
+    case 2:
+        return cv::IMREAD_REDUCED_COLOR_2;
+    case 4:
+        return cv::IMREAD_REDUCED_COLOR_4;
+    case 8:
+        return cv::IMREAD_REDUCED_COLOR_8;
+    default:
+        return cv::IMREAD_COLOR;
+    }
+}
+
 bool Tiles::checkExtension(const std::string& extension) const
 {
     if (extension == ".bmp") return true;
@@ -171,18 +245,17 @@ void Tiles::removeTemp() const
     }
 }
 
-void Tiles::computeTileFeatures(const cv::Mat& image, const FaceDetectionROI& roi, const cv::Size& tileSize, Data& data, int threadID)
+void Tiles::computeTileFeatures(const cv::Mat& image, const FaceDetectionROI& roi, const cv::Size& tileSize, Data& data, FaceDetectionROI::Detection& detection, int threadID)
 {
-    cv::Rect box;
     cv::Mat tileMat;
 
-    computeCropInfo(image, box, roi, tileSize, threadID);
-    ImageUtils::resample(tileMat, tileSize, image, box, ImageUtils::LANCZOS);
-    ImageUtils::computeFeatures(tileMat, data._features, FeatureDiv, NbFeatures);
+    computeCropInfo(image, data._box, roi, tileSize, detection, threadID);
+    ImageUtils::resample(tileMat, tileSize, image, data._box, ImageUtils::LANCZOS);
+    computeFeatures(tileMat, data._features);
     exportTile(tileMat, data._tilePath);
 }
 
-void Tiles::computeCropInfo(const cv::Mat& image, cv::Rect& box, const FaceDetectionROI& roi, const cv::Size& tileSize, int threadID)
+void Tiles::computeCropInfo(const cv::Mat& image, cv::Rect& box, const FaceDetectionROI& roi, const cv::Size& tileSize, FaceDetectionROI::Detection& detection, int threadID)
 {
     if (image.size() == tileSize)
     {
@@ -199,7 +272,7 @@ void Tiles::computeCropInfo(const cv::Mat& image, cv::Rect& box, const FaceDetec
     box.width = (int)ceil(tileSize.width * scaleInv);
     box.height = (int)ceil(tileSize.height * scaleInv);
 
-    roi.find(image, box, wScaleInv < hScaleInv, threadID);
+    roi.find(image, box, wScaleInv < hScaleInv, threadID, detection);
 }
 
 void Tiles::exportTile(const cv::Mat& tile, const std::string& tilePath)
@@ -6,6 +6,8 @@
 #include "CustomException.h"
 #include "Parameters.h"
 #include "MosaicGenerator.h"
+#include "MosaicServer.h"
+#include "MosaicBatch.h"
 #include "SystemUtils.h"
 #include "Log.h"
 #include "Console.h"
@@ -34,8 +36,23 @@ int main(int argc, char* argv[])
 #endif
 
         parameters.initialize(argc, argv);
-        MosaicGenerator generator(parameters);
-        generator.Build();
+        if (parameters.getVerbose() && !Log::Logger::get().isEnabled(Log::DEBUG))
+            Log::Logger::get().setLevel(Log::Level::DEBUG);
+        if (parameters.getServer())
+        {
+            MosaicServer server(parameters);
+            server.run();
+        }
+        else if (!parameters.getBatchPath().empty())
+        {
+            MosaicBatch batch(parameters);
+            batch.run();
+        }
+        else
+        {
+            MosaicGenerator generator(parameters);
+            generator.Build();
+        }
 
         std::string timeStamp = clock.getTimeStamp();
         Console::Out::get(Console::TIME) << timeStamp;
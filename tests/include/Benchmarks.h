@@ -0,0 +1,8 @@
+#pragma once
+
+
+namespace Benchmarks
+{
+    void runGaussianMixtureModel(); //Scalar and SoA double / float kernels on a synthetic tile histogram.
+    void runColorEnhancerCoverage(); //Sobol sampling coverage against the pseudo-random reference.
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ColorEnhancer.h"
+#include <vector>
+
+
+class ColorEnhancerTests //Friend of ColorEnhancer, checks and measures its lattice transfer and sampling coverage
+{
+public:
+    static constexpr int TileSide = 128;
+
+public:
+    static void runLut();
+    static void runCoverageBench();
+
+public:
+    static void computeTileImage(std::vector<uchar>& pixels, double hueShift, double brightness); //Fixed synthetic tile, same pixels for same parameters.
+    static void fitGmm(ProbaUtils::GMMNDComponents<3>& gmm, const ProbaUtils::Histogram<3>& histogram); //Fit parameters of MosaicBuilder.
+};
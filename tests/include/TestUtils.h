@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "CustomException.h"
+
+
+namespace TestUtils
+{
+    inline void check(bool condition, const std::string& message)
+    {
+        if (!condition)
+            throw CustomException("Check failed : " + message, CustomException::Level::ERROR);
+    }
+
+    inline double computePSNR(double sqErrorSum, int nbValues) //8-bit levels peak signal
+    {
+        if (sqErrorSum <= 0 || nbValues <= 0)
+            return std::numeric_limits<double>::infinity();
+        return 10. * std::log10(255. * 255. * (double)nbValues / sqErrorSum);
+    }
+
+    template<typename Function>
+    double measure(Function function, int nbRuns) //Mean duration of a run in microseconds, first run is a warm up
+    {
+        function();
+        std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < nbRuns; r++)
+            function();
+        std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::micro>(endTime - startTime).count() / nbRuns;
+    }
+}
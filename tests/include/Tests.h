@@ -0,0 +1,8 @@
+#pragma once
+
+
+namespace Tests
+{
+    void runGuidedFilter(); //Streaming and subsampled guided filters against the double precision reference filter.
+    void runColorEnhancerLut(); //Lattice color transfer against the exact transfer of tile colors.
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <iomanip>
+#include "Benchmarks.h"
+#include "TestUtils.h"
+#include "ColorEnhancerTests.h"
+
+
+namespace
+{
+    //Samplers of MosaicBuilder and its former reference mode
+    constexpr int NbSobolSamples = 1 << 18;
+    constexpr int NbReferenceSamples = 1000000;
+
+    //Synthetic tile set, hue shift and brightness of each tile
+    constexpr double TileParameters[][2] = {{0., 1.}, {20., 1.}, {-35., 0.7}, {60., 0.5}, {-80., 1.2}, {110., 0.3}, {5., 0.9}, {-15., 0.6}};
+}
+
+void ColorEnhancerTests::runCoverageBench()
+{
+    std::vector<ProbaUtils::GMMNDComponents<3>> gmms;
+    for (const auto& parameters : TileParameters)
+    {
+        std::vector<uchar> pixels;
+        computeTileImage(pixels, parameters[0], parameters[1]);
+        ProbaUtils::Histogram<3> histogram;
+        ProbaUtils::computeHistogram(histogram, pixels.data(), TileSide * TileSide);
+        gmms.emplace_back();
+        fitGmm(gmms.back(), histogram);
+    }
+
+    //Coverage search evaluates interpolated mixtures, midpoints between consecutive tiles are measured too
+    const int nbTiles = gmms.size();
+    for (int g = 0; g + 1 < nbTiles; g++)
+    {
+        ProbaUtils::W2Minimizers wstar;
+        ProbaUtils::GMMTransport<3> transport;
+        ProbaUtils::computeGmmW2<3>(wstar, gmms[g], gmms[g + 1]);
+        ProbaUtils::computeGmmTransport<3>(transport, gmms[g], gmms[g + 1], wstar);
+        gmms.emplace_back();
+        ProbaUtils::computeGmmInterpolation<3>(gmms.back(), 0.5, transport);
+    }
+
+    ProbaUtils::GMMSamplerDatas<3> sobolDatas, randomDatas, referenceDatas, seedDatas;
+    ProbaUtils::generateGMMSamplerDatas<3>(sobolDatas, NbSobolSamples, ProbaUtils::SOBOL, true);
+    ProbaUtils::generateGMMSamplerDatas<3>(randomDatas, NbSobolSamples, ProbaUtils::PSEUDO_RANDOM, true);
+    ProbaUtils::generateGMMSamplerDatas<3>(referenceDatas, NbReferenceSamples, ProbaUtils::PSEUDO_RANDOM, true);
+    ProbaUtils::generateGMMSamplerDatas<3>(seedDatas, NbReferenceSamples, ProbaUtils::PSEUDO_RANDOM, false);
+
+    double maxSobolError = 0, meanSobolError = 0, maxRandomError = 0, meanRandomError = 0, maxSeedError = 0, meanSeedError = 0;
+    double sobolTime = 0, referenceTime = 0;
+    for (const auto& gmm : gmms)
+    {
+        double sobolCoverage = 0, referenceCoverage = 0;
+        sobolTime += TestUtils::measure([&]()
+            {
+                sobolCoverage = ColorEnhancer::computeGMMSamplingCoverage(gmm, sobolDatas, ColorEnhancer::CoverageGridDivisions, ColorEnhancer::CoverageConfidence);
+            }, 1);
+        referenceTime += TestUtils::measure([&]()
+            {
+                referenceCoverage = ColorEnhancer::computeGMMSamplingCoverage(gmm, referenceDatas, ColorEnhancer::CoverageGridDivisions, ColorEnhancer::CoverageConfidence);
+            }, 1);
+        const double randomCoverage = ColorEnhancer::computeGMMSamplingCoverage(gmm, randomDatas, ColorEnhancer::CoverageGridDivisions, ColorEnhancer::CoverageConfidence);
+        const double seedCoverage = ColorEnhancer::computeGMMSamplingCoverage(gmm, seedDatas, ColorEnhancer::CoverageGridDivisions, ColorEnhancer::CoverageConfidence);
+
+        const double sobolError = std::abs(sobolCoverage - referenceCoverage) / referenceCoverage;
+        const double randomError = std::abs(randomCoverage - referenceCoverage) / referenceCoverage;
+        const double seedError = std::abs(seedCoverage - referenceCoverage) / referenceCoverage;
+        maxSobolError = std::max(maxSobolError, sobolError);
+        meanSobolError += sobolError / gmms.size();
+        maxRandomError = std::max(maxRandomError, randomError);
+        meanRandomError += randomError / gmms.size();
+        maxSeedError = std::max(maxSeedError, seedError);
+        meanSeedError += seedError / gmms.size();
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Sampling coverage : " << nbTiles << " synthetic tiles and " << gmms.size() - nbTiles << " interpolated mixtures, reference " << NbReferenceSamples << " pseudo-random samples" << std::endl;
+    std::cout << "  Sobol " << NbSobolSamples << " samples      : " << sobolTime / gmms.size() << " us, relative error mean " << 100. * meanSobolError << "%, max " << 100. * maxSobolError << "%" << std::endl;
+    std::cout << "  Pseudo-random " << NbSobolSamples << " samples : relative error mean " << 100. * meanRandomError << "%, max " << 100. * maxRandomError << "%" << std::endl;
+    std::cout << "  Pseudo-random other seed : " << referenceTime / gmms.size() << " us, relative error mean " << 100. * meanSeedError << "%, max " << 100. * maxSeedError << "%" << std::endl;
+}
+
+void Benchmarks::runColorEnhancerCoverage()
+{
+    ColorEnhancerTests::runCoverageBench();
+}
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include "Tests.h"
+#include "TestUtils.h"
+#include "ColorEnhancerTests.h"
+
+
+namespace
+{
+    constexpr double LutMinPSNR = 30.; //Lattice transfer against the exact transfer of tile colors
+    constexpr double LutMaxDarkening = 8.; //Saturated tile colors, mean channel loss in 8-bit levels
+    constexpr int NbSobolSamples = 1 << 16;
+
+    //Fit parameters of MosaicBuilder
+    constexpr int MaxNbCompo = 10;
+    constexpr int NbInit = 20;
+    constexpr int MaxIter = 1000;
+    constexpr double ConvergenceTol = 1e-3;
+    constexpr double CovarianceReg = 1e-6;
+    constexpr int BICPatience = 2;
+}
+
+void ColorEnhancerTests::runLut()
+{
+    std::vector<uchar> tilePixels, cellPixels;
+    computeTileImage(tilePixels, 20., 1.);
+    computeTileImage(cellPixels, -35., 0.7);
+
+    ProbaUtils::Histogram<3> tileHistogram, cellHistogram;
+    ProbaUtils::computeHistogram(tileHistogram, tilePixels.data(), TileSide * TileSide);
+    ProbaUtils::computeHistogram(cellHistogram, cellPixels.data(), TileSide * TileSide);
+    ProbaUtils::GMMNDComponents<3> tileGmm, cellGmm;
+    fitGmm(tileGmm, tileHistogram);
+    fitGmm(cellGmm, cellHistogram);
+
+    ProbaUtils::GMMSamplerDatas<3> datas;
+    ProbaUtils::generateGMMSamplerDatas<3>(datas, NbSobolSamples, ProbaUtils::SOBOL, true);
+    ColorEnhancer::Source source(tileHistogram, tileGmm, datas, cv::Size(TileSide, TileSide));
+    TestUtils::check(source._useLut, "lattice transfer used on a tile with " + std::to_string(tileHistogram._values.size()) + " colors");
+    ColorEnhancer enhancer(source, cellGmm, datas);
+
+    //Lattice transfer is compared with the exact transfer of tile colors, saturated colors must not be darkened by lattice nodes out of tile gamut
+    const int nbValues = tileHistogram._values.size();
+    std::vector<double> compProbas;
+    ProbaUtils::evalGaussianPosteriors(compProbas, tileHistogram._values, tileGmm);
+    for (double t : {0.25, 0.5, 1.})
+    {
+        std::vector<MathUtils::VectorNd<3>> colorMap(nbValues, MathUtils::VectorNd<3>::Zero());
+        std::vector<MathUtils::VectorNd<3>> exactMap(nbValues, MathUtils::VectorNd<3>::Zero());
+        enhancer.computeColorMap(colorMap, t);
+        enhancer.computeTransfer(exactMap, tileHistogram._values, compProbas, t);
+
+        double sqErrorSum = 0;
+        double maxDarkening = 0;
+        int nbSaturated = 0;
+        for (int h = 0; h < nbValues; h++)
+        {
+            sqErrorSum += tileHistogram._counts[h] * (colorMap[h] - exactMap[h]).squaredNorm();
+            const MathUtils::VectorNd<3>& value = tileHistogram._values[h];
+            if (value.minCoeff() <= 0 || value.maxCoeff() >= 255)
+            {
+                maxDarkening = std::max(maxDarkening, (exactMap[h] - colorMap[h]).sum() / 3.);
+                nbSaturated++;
+            }
+        }
+
+        const double PSNR = TestUtils::computePSNR(sqErrorSum, tileHistogram._nbData * 3);
+        std::cout << "Lattice transfer t = " << t << " : PSNR against exact transfer " << PSNR << " dB, " << nbSaturated << " saturated colors darkening " << maxDarkening << std::endl;
+        TestUtils::check(PSNR >= LutMinPSNR, "lattice transfer PSNR above " + std::to_string(LutMinPSNR) + " dB");
+        TestUtils::check(maxDarkening <= LutMaxDarkening, "lattice transfer darkening of saturated colors below " + std::to_string(LutMaxDarkening) + " levels");
+    }
+}
+
+void ColorEnhancerTests::computeTileImage(std::vector<uchar>& pixels, double hueShift, double brightness)
+{
+    //Noisy color gradients clipped at both ends, flat saturated bands on the top and left borders
+    std::mt19937 gen;
+    std::normal_distribution<double> noise(0., 8.);
+    pixels.resize(TileSide * TileSide * 3);
+    for (int i = 0, k = 0; i < TileSide; i++)
+    {
+        for (int j = 0; j < TileSide; j++)
+        {
+            for (int c = 0; c < 3; c++, k++)
+            {
+                double level = brightness * (128. + 120. * std::sin(0.05 * (i + hueShift * c) + 0.03 * j * (c + 1)));
+                if (i < TileSide / 8)
+                    level = c == 2 ? 255. : 0.;
+                else if (j < TileSide / 8)
+                    level = c == 0 ? 255. : 20. * c;
+                else
+                    level += noise(gen);
+                pixels[k] = (uchar)std::clamp(std::round(level), 0., 255.);
+            }
+        }
+    }
+}
+
+void ColorEnhancerTests::fitGmm(ProbaUtils::GMMNDComponents<3>& gmm, const ProbaUtils::Histogram<3>& histogram)
+{
+    ProbaUtils::GMMFitStats stats;
+    GaussianMixtureModel<3>::findOptimalComponents(gmm, histogram, 1, MaxNbCompo, NbInit, MaxIter, ConvergenceTol, CovarianceReg, true, stats, BICPatience);
+    TestUtils::check(!gmm.empty(), "GMM fit on test tile");
+}
+
+void Tests::runColorEnhancerLut()
+{
+    ColorEnhancerTests::runLut();
+}
@@ -0,0 +1,158 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include "Benchmarks.h"
+#include "TestUtils.h"
+#include "GaussianMixtureModel.h"
+
+
+namespace
+{
+    constexpr int TileSide = 128;
+    constexpr int NbClusters = 6;
+    constexpr double ClusterDeviation = 12.;
+    constexpr int NbRuns = 50;
+    constexpr int NbFitRuns = 5;
+
+    //Fit parameters of MosaicBuilder
+    constexpr int NbInit = 3;
+    constexpr int MaxIter = 200;
+    constexpr int MaxNbCompo = 8;
+    constexpr double ConvergenceTol = 1e-3;
+    constexpr double CovarianceReg = 1e-3;
+    constexpr int BICPatience = 2;
+
+    void computeSyntheticHistogram(ProbaUtils::Histogram<3>& histogram)
+    {
+        //Gaussian color clusters, seeded for reproducible timings
+        std::mt19937 gen;
+        std::uniform_real_distribution<double> uniformCenter(40., 215.);
+        std::normal_distribution<double> normal(0., ClusterDeviation);
+        std::uniform_int_distribution<int> uniformCluster(0, NbClusters - 1);
+
+        double centers[NbClusters][3];
+        for (auto& center : centers)
+            for (double& channel : center)
+                channel = uniformCenter(gen);
+
+        std::vector<uchar> pixels(3 * TileSide * TileSide);
+        for (int p = 0; p < TileSide * TileSide; p++)
+        {
+            const int cluster = uniformCluster(gen);
+            for (int n = 0; n < 3; n++)
+                pixels[3 * p + n] = (uchar)std::clamp(std::round(centers[cluster][n] + normal(gen)), 0., 255.);
+        }
+        ProbaUtils::computeHistogram(histogram, pixels.data(), TileSide * TileSide);
+    }
+
+    void computeScalarStatistics(ProbaUtils::GMMNDComponents<3>& gmm, const std::vector<double>& resps, const ProbaUtils::Histogram<3>& histogram)
+    {
+        //Value-major responsabilities, same sums as the SoA kernel with Eigen vectors
+        const int nbValues = histogram._values.size();
+        const int nbComponents = gmm.size();
+        for (int c = 0; c < nbComponents; c++)
+        {
+            gmm[c]._weight = 0;
+            gmm[c]._mean.setZero();
+            gmm[c]._covariance.setZero();
+        }
+        for (int b = 0, r = 0; b < nbValues; b++)
+        {
+            for (int c = 0; c < nbComponents; c++, r++)
+            {
+                const double weightedResp = resps[r] * histogram._counts[b];
+                gmm[c]._weight += weightedResp;
+                gmm[c]._mean += weightedResp * histogram._values[b];
+            }
+        }
+        for (int c = 0; c < nbComponents; c++)
+            gmm[c]._mean /= gmm[c]._weight;
+        for (int b = 0, r = 0; b < nbValues; b++)
+        {
+            for (int c = 0; c < nbComponents; c++, r++)
+            {
+                const MathUtils::VectorNd<3> meanValDiff = histogram._values[b] - gmm[c]._mean;
+                gmm[c]._covariance += resps[r] * histogram._counts[b] * meanValDiff * meanValDiff.transpose();
+            }
+        }
+        for (int c = 0; c < nbComponents; c++)
+            gmm[c]._covariance /= gmm[c]._weight;
+    }
+
+    void toParameters(std::vector<double>& params, const std::vector<double>& norms, const ProbaUtils::GMMNDComponents<3>& gmm)
+    {
+        params = norms;
+        for (const auto& component : gmm)
+        {
+            params.push_back(component._weight);
+            params.insert(params.end(), component._mean.data(), component._mean.data() + 3);
+            params.insert(params.end(), component._covariance.data(), component._covariance.data() + 9);
+        }
+    }
+
+    template<typename T>
+    double measureSoAStep(const ProbaUtils::Histogram<3>& histogram, const ProbaUtils::GMMNDComponents<3>& gmm, std::vector<double>& params)
+    {
+        ProbaUtils::HistogramSoA<3, T> histogramSoA;
+        ProbaUtils::toSoA(histogramSoA, histogram);
+        std::vector<T> densities(gmm.size() * histogram._values.size());
+        std::vector<T> norms(histogram._values.size());
+        ProbaUtils::GMMNDComponents<3> statistics = gmm;
+        const double time = TestUtils::measure([&]()
+            {
+                ProbaUtils::evalGaussianPDF(densities, norms, histogramSoA, gmm, true);
+                ProbaUtils::computeGaussianStatistics(statistics, densities, histogramSoA);
+            }, NbRuns);
+        toParameters(params, std::vector<double>(norms.begin(), norms.end()), statistics);
+        return time;
+    }
+
+    double measureFit(const ProbaUtils::Histogram<3>& histogram, ProbaUtils::GMMNDComponents<3>& gmm)
+    {
+        return TestUtils::measure([&]()
+            {
+                ProbaUtils::GMMFitStats stats;
+                GaussianMixtureModel<3>::findOptimalComponents(gmm, histogram, 1, MaxNbCompo, NbInit, MaxIter, ConvergenceTol, CovarianceReg, true, stats, BICPatience);
+            }, NbFitRuns);
+    }
+
+    double computeMaxRelativeError(const std::vector<double>& values, const std::vector<double>& references)
+    {
+        double maxError = 0;
+        for (int v = 0; v < values.size(); v++)
+            maxError = std::max(maxError, std::abs(values[v] - references[v]) / std::max(std::abs(references[v]), MathUtils::DoubleEpsilon));
+        return maxError;
+    }
+}
+
+void Benchmarks::runGaussianMixtureModel()
+{
+    ProbaUtils::Histogram<3> histogram;
+    computeSyntheticHistogram(histogram);
+    const int nbValues = histogram._values.size();
+
+    ProbaUtils::GMMNDComponents<3> gmm;
+    const double fitTime = measureFit(histogram, gmm);
+    TestUtils::check(!gmm.empty(), "GMM fit on synthetic histogram");
+
+    //One EM step : densities and responsabilities, then weighted statistics, scalar path is the reference
+    std::vector<double> densities(gmm.size() * nbValues);
+    std::vector<double> norms(nbValues);
+    ProbaUtils::GMMNDComponents<3> statistics = gmm;
+    const double scalarTime = TestUtils::measure([&]()
+        {
+            ProbaUtils::evalGaussianPDF(densities, norms, histogram._values, gmm, true);
+            computeScalarStatistics(statistics, densities, histogram);
+        }, NbRuns);
+    std::vector<double> params, paramsDouble, paramsFloat;
+    toParameters(params, norms, statistics);
+    const double SoADoubleTime = measureSoAStep<double>(histogram, gmm, paramsDouble);
+    const double SoAFloatTime = measureSoAStep<float>(histogram, gmm, paramsFloat);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "GMM kernels : " << TileSide << "x" << TileSide << " tile, " << nbValues << " histogram values, " << gmm.size() << " components" << std::endl;
+    std::cout << "  EM step scalar double : " << scalarTime << " us" << std::endl;
+    std::cout << "  EM step SoA double    : " << SoADoubleTime << " us, max relative error " << std::scientific << computeMaxRelativeError(paramsDouble, params) << std::fixed << std::endl;
+    std::cout << "  EM step SoA float     : " << SoAFloatTime << " us, max relative error " << std::scientific << computeMaxRelativeError(paramsFloat, params) << std::fixed << std::endl;
+    std::cout << "  Full fit              : " << fitTime << " us, " << gmm.size() << " components" << std::endl;
+}
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include "Tests.h"
+#include "TestUtils.h"
+#include "ImageUtils.h"
+
+
+namespace
+{
+    //Filter parameters of ColorEnhancer
+    constexpr int FilterRadius = 4;
+    constexpr double FilterEpsilon = (0.01 * 255) * (0.01 * 255);
+    constexpr double FilterReferenceTolerance = 1e-2; //In 8-bit levels
+    constexpr double FilterMinPSNR = 40.; //Enhanced tiles of the subsampled filter against the exact filter ones
+
+    void computeTileImages(std::vector<double>& guide, std::vector<double>& image, const cv::Size& size)
+    {
+        //Guide has gradients, a sharp disk edge and noise, image is a smooth color shift with guide correlated details
+        std::mt19937 gen;
+        std::normal_distribution<double> noise(0., 6.);
+        const double radius = 0.3 * std::min(size.width, size.height);
+        guide.resize(size.area() * 3);
+        image.resize(size.area() * 3);
+        for (int i = 0, k = 0; i < size.height; i++)
+        {
+            for (int j = 0; j < size.width; j++)
+            {
+                const double dx = j - 0.5 * size.width;
+                const double dy = i - 0.5 * size.height;
+                const bool inside = dx * dx + dy * dy < radius * radius;
+                for (int c = 0; c < 3; c++, k++)
+                {
+                    const double level = (inside ? 200. - 40. * c : 30. + 50. * c) + 40. * j / size.width - 30. * i / size.height;
+                    guide[k] = std::clamp(std::round(level + noise(gen)), 0., 255.);
+                    image[k] = 20. * std::sin(0.1 * (j + 2 * c)) - 15. * std::cos(0.07 * i) + 0.1 * (guide[k] - 128.);
+                }
+            }
+        }
+    }
+
+    double computeMaxDifference(const std::vector<double>& values, const std::vector<double>& references)
+    {
+        double maxDiff = 0;
+        for (int k = 0; k < references.size(); k++)
+            maxDiff = std::max(maxDiff, std::abs(values[k] - references[k]));
+        return maxDiff;
+    }
+
+    double computeEnhancedPSNR(const std::vector<double>& filtered, const std::vector<double>& reference, const std::vector<double>& guide)
+    {
+        //Filtered shifts are applied to the guide colors and rounded like ColorEnhancer enhanced tiles
+        double sqErrorSum = 0;
+        for (int k = 0; k < guide.size(); k++)
+        {
+            const double error = (double)(uchar)std::clamp(guide[k] + filtered[k], 0., 255.) - (double)(uchar)std::clamp(guide[k] + reference[k], 0., 255.);
+            sqErrorSum += error * error;
+        }
+        return TestUtils::computePSNR(sqErrorSum, guide.size());
+    }
+}
+
+void Tests::runGuidedFilter()
+{
+    //Tile sizes filtered without subsampling, odd sizes cover partial blocks and borders
+    const cv::Size sizes[] = {cv::Size(64, 64), cv::Size(96, 72), cv::Size(37, 23)};
+    for (const cv::Size& size : sizes)
+    {
+        std::vector<double> guide, image;
+        computeTileImages(guide, image, size);
+
+        std::vector<double> reference;
+        ImageUtils::guidedFiltering(reference, image, guide, size, FilterRadius, FilterEpsilon);
+
+        ImageUtils::GuidedFilter guidedFilter(guide, size, FilterRadius, FilterEpsilon);
+        ImageUtils::GuidedFilter::Buffers buffers;
+        std::vector<double> filtered(image.size());
+        guidedFilter.apply(filtered, image, buffers);
+
+        const double maxDiff = computeMaxDifference(filtered, reference);
+        std::cout << "Guided filter " << size.width << "x" << size.height << " : max difference with reference filter " << maxDiff << std::endl;
+        TestUtils::check(maxDiff <= FilterReferenceTolerance, "guided filter within " + std::to_string(FilterReferenceTolerance) + " of reference filter");
+
+        //Buffers are reused by every cell of a tile
+        guidedFilter.apply(filtered, image, buffers);
+        TestUtils::check(computeMaxDifference(filtered, reference) == maxDiff, "guided filter result independent of buffer reuse");
+    }
+
+    //Smallest tile sides of ColorEnhancer 2x and 4x subsampled filters
+    const std::pair<cv::Size, int> subsampledSizes[] = {{cv::Size(128, 128), 2}, {cv::Size(256, 256), 4}, {cv::Size(300, 260), 4}};
+    for (const auto& [size, subsampling] : subsampledSizes)
+    {
+        std::vector<double> guide, image;
+        computeTileImages(guide, image, size);
+
+        std::vector<double> reference;
+        ImageUtils::guidedFiltering(reference, image, guide, size, FilterRadius, FilterEpsilon);
+
+        ImageUtils::GuidedFilter guidedFilter(guide, size, FilterRadius, FilterEpsilon, subsampling);
+        ImageUtils::GuidedFilter::Buffers buffers;
+        std::vector<double> filtered(image.size());
+        guidedFilter.apply(filtered, image, buffers);
+
+        const double PSNR = computeEnhancedPSNR(filtered, reference, guide);
+        std::cout << "Guided filter " << size.width << "x" << size.height << " subsampled " << subsampling << "x : PSNR against exact filter " << PSNR << " dB" << std::endl;
+        TestUtils::check(PSNR >= FilterMinPSNR, "subsampled guided filter PSNR above " + std::to_string(FilterMinPSNR) + " dB");
+    }
+}
@@ -0,0 +1,40 @@
+#include <iostream>
+#include <string>
+#include "CustomException.h"
+#include "Tests.h"
+#include "Benchmarks.h"
+
+
+int main(int argc, char* argv[])
+{
+    int exitCode = EXIT_SUCCESS;
+
+    try
+    {
+        //Tests run by default, benchmarks on demand
+        std::string mode = argc > 1 ? argv[1] : "";
+        if (mode == "--bench")
+        {
+            Benchmarks::runGaussianMixtureModel();
+            Benchmarks::runColorEnhancerCoverage();
+        }
+        else if (mode.empty())
+        {
+            Tests::runGuidedFilter();
+            Tests::runColorEnhancerLut();
+            std::cout << "All tests passed." << std::endl;
+        }
+        else
+        {
+            std::cout << "Usage : Photo_Mosaic_Generator_Tests [--bench]" << std::endl;
+            exitCode = EXIT_FAILURE;
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cout << e.what() << std::endl;
+        exitCode = EXIT_FAILURE;
+    }
+
+    return exitCode;
+}